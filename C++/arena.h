@@ -0,0 +1,179 @@
+/**
+ * Arena
+ *
+ * A monotonic allocator for everything one decode creates: the strings
+ * and the lists of 100,000 work orders are millions of small allocations,
+ * each its own trip through malloc and free, and in a long running
+ * process they fragment the heap between refreshes.
+ *
+ *   1. Memory comes from large blocks; an allocation is a pointer bump in
+ *      the current block, a new block is only allocated when it is full
+ *   2. Blocks start at 64 KB and double up to 4 MB, so a big response
+ *      takes a handful of blocks and a small one doesn't reserve megabytes
+ *   3. Nothing is freed on its own. The arena frees all its blocks at once
+ *      when it is destroyed
+ *
+ * An Arena is not thread-safe; every decode has its own. ArenaAllocator
+ * lets standard containers allocate from one.
+ *
+ * Header only, include it from work_order.h.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+class Arena {
+public:
+    static constexpr size_t FIRST_BLOCK = 64 * 1024;
+    static constexpr size_t MAX_BLOCK = 4 * 1024 * 1024;
+
+    Arena() = default;
+
+    // Containers and views hold pointers to the arena and into its blocks
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        while (blocks) {
+            Block* next = blocks->next;
+            std::free(blocks);
+            blocks = next;
+        }
+    }
+
+    /**
+     * allocate - size bytes aligned to alignment (a power of two), valid
+     * until the arena is destroyed. Throws std::bad_alloc if a new block
+     * can't be allocated.
+     */
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+        uintptr_t start = (current + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        if (!blocks || start + size > end) {
+            addBlock(size + alignment);
+            start = (current + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        }
+        current = start + size;
+        used += size;
+        return reinterpret_cast<void*>(start);
+    }
+
+    /**
+     * copy - A copy of text that lives in the arena.
+     */
+    std::string_view copy(std::string_view text) {
+        if (text.empty()) return {};
+        char* data = static_cast<char*>(allocate(text.size(), 1));
+        std::memcpy(data, text.data(), text.size());
+        return {data, text.size()};
+    }
+
+    /**
+     * bytesUsed / bytesReserved - What was allocated, and what the blocks
+     * holding it take.
+     */
+    size_t bytesUsed() const {
+        return used;
+    }
+
+    size_t bytesReserved() const {
+        return reserved;
+    }
+
+private:
+    struct alignas(std::max_align_t) Block {
+        Block* next;
+    };
+
+    void addBlock(size_t atLeast) {
+        size_t size = std::max(nextBlock, atLeast + sizeof(Block));
+        Block* block = static_cast<Block*>(std::malloc(size));
+        if (!block) throw std::bad_alloc();
+        block->next = blocks;
+        blocks = block;
+        current = reinterpret_cast<uintptr_t>(block + 1);
+        end = reinterpret_cast<uintptr_t>(block) + size;
+        reserved += size;
+        nextBlock = std::min(nextBlock * 2, MAX_BLOCK);
+    }
+
+    Block* blocks = nullptr;
+    uintptr_t current = 0;
+    uintptr_t end = 0;
+    size_t nextBlock = FIRST_BLOCK;
+    size_t used = 0;
+    size_t reserved = 0;
+};
+
+/**
+ * ArenaAllocator - A standard allocator that takes memory from an Arena.
+ *
+ * Deallocating is a no-op; the memory goes back when the arena does. A
+ * default constructed allocator has no arena and uses the heap, so
+ * containers that are built outside a decode, or copied out of one,
+ * behave like plain ones.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ArenaAllocator() = default;
+
+    explicit ArenaAllocator(Arena* arena) : arena(arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) {
+        if (arena) return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+        return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t) {
+        if (!arena) ::operator delete(p);
+    }
+
+    /**
+     * select_on_container_copy_construction - Copies go to the heap, so a
+     * copy can outlive the arena of the original (its views can't).
+     */
+    ArenaAllocator select_on_container_copy_construction() const {
+        return ArenaAllocator();
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+        return arena == other.arena;
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const {
+        return arena != other.arena;
+    }
+
+private:
+    template <typename U>
+    friend class ArenaAllocator;
+
+    Arena* arena = nullptr;
+};
+
+/**
+ * ArenaVector - A std::vector that can live in an Arena.
+ */
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif
@@ -0,0 +1,390 @@
+/**
+ * JsonWriter Benchmark
+ *
+ * Measures each stage of turning an API response into output, on
+ * synthetic projectWorkOrders payloads from PayloadGenerator, so changes
+ * can be measured instead of guessed:
+ *
+ *   1. prettyPrint and escape against the original character-by-character
+ *      implementations, and the prettyPrint + count pass outputSuccess
+ *      makes
+ *   2. The streaming formatter --stream uses, fed 64 KB chunks
+ *   3. Decoding into WorkOrder structs (--typed) and writing them back
+ *   4. Building a WorkOrderIndex and querying it (--filter), against a
+ *      scan of the decoded work orders
+ *   5. Building WorkOrderColumns and summing a cost column, against the
+ *      same sum over the structs
+ *   6. Aggregating the default money fields per facility and currency
+ *      (--aggregate), against the same group-by over the structs
+ *
+ * Every stage reports nanoseconds per work order and heap allocations per
+ * run, and the stages that read the payload or strings MB/s of them.
+ * Allocations are counted by replacing the global operator new, so the
+ * numbers cover everything a stage does.
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 -o bench bench.cpp
+ *
+ * Run:
+ *   ./bench
+ *   ./bench --sizes=1000,100000,1000000
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "json_writer.h"
+#include "payload_generator.h"
+#include "work_order.h"
+#include "work_order_aggregate.h"
+#include "work_order_columns.h"
+#include "work_order_index.h"
+
+/**
+ * allocations - Number of calls to the global operator new so far.
+ */
+std::atomic<uint64_t> allocations{0};
+
+__attribute__((noinline)) void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new(size_t size, std::align_val_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align)) return p;
+    throw std::bad_alloc();
+}
+
+// The array, sized and aligned forms are replaced too, so every
+// allocation is counted and freed by the matching function. noinline keeps
+// GCC from seeing malloc() on one side and operator delete on the other
+// and warning about a mismatch (-Wmismatched-new-delete)
+__attribute__((noinline)) void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+__attribute__((noinline)) void* operator new[](size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+/**
+ * legacyPrettyPrint - The original JsonWriter::prettyPrint, kept here as the
+ * baseline. Builds a temporary indent string for every structural character
+ * and grows the result one character at a time.
+ */
+std::string legacyPrettyPrint(const std::string& json) {
+    std::string result;
+    int indent = 0;
+    bool inString = false;
+    char prevChar = 0;
+
+    for (size_t i = 0; i < json.length(); i++) {
+        char c = json[i];
+
+        if (c == '"' && prevChar != '\\') {
+            inString = !inString;
+        }
+
+        if (!inString) {
+            if (c == '{' || c == '[') {
+                result += c;
+                result += '\n';
+                indent++;
+                result += std::string(indent * 2, ' ');
+            } else if (c == '}' || c == ']') {
+                result += '\n';
+                indent--;
+                result += std::string(indent * 2, ' ');
+                result += c;
+            } else if (c == ',') {
+                result += c;
+                result += '\n';
+                result += std::string(indent * 2, ' ');
+            } else if (c == ':') {
+                result += c;
+                result += ' ';
+            } else if (c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+                result += c;
+            }
+        } else {
+            result += c;
+        }
+
+        prevChar = c;
+    }
+
+    return result;
+}
+
+/**
+ * legacyEscape - The original JsonWriter::escape, kept as the baseline.
+ */
+std::string legacyEscape(const std::string& s) {
+    std::string result;
+    for (char c : s) {
+        switch (c) {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            default: result += c;
+        }
+    }
+    return result;
+}
+
+/**
+ * Measurement - Average cost of one run of a stage.
+ */
+struct Measurement {
+    double seconds = 0;
+    double allocations = 0;
+};
+
+/**
+ * measure - Runs fn repeatedly for at least half a second, and at least
+ * once, and returns the average time and allocations per run.
+ */
+Measurement measure(const std::function<size_t()>& fn) {
+    using Clock = std::chrono::steady_clock;
+    size_t sink = 0;
+    int runs = 0;
+    uint64_t allocationsBefore = allocations.load(std::memory_order_relaxed);
+    auto start = Clock::now();
+    double seconds = 0;
+
+    do {
+        sink += fn();
+        runs++;
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (seconds < 0.5);
+
+    if (sink == 0) std::cout << "";
+    Measurement m;
+    m.seconds = seconds / runs;
+    m.allocations = static_cast<double>(allocations.load(std::memory_order_relaxed) - allocationsBefore) / runs;
+    return m;
+}
+
+/**
+ * report - Prints one stage: MB/s of inputBytes, ns per item, allocations
+ * per run, and the speedup over baseline if one is given. Stages that
+ * don't read any input (they work on decoded work orders) pass 0 for
+ * inputBytes and only get ns per item.
+ */
+void report(const char* stage, size_t inputBytes, size_t items, const Measurement& m,
+            const Measurement* baseline = nullptr) {
+    std::cout << std::left << std::setw(36) << stage << std::right << std::fixed << std::setprecision(2);
+    if (inputBytes > 0) {
+        std::cout << std::setw(10) << inputBytes / m.seconds / (1024.0 * 1024.0) << " MB/s";
+    } else {
+        std::cout << std::setw(15) << "";
+    }
+    std::cout << std::setw(12) << m.seconds * 1e9 / items << " ns/item"
+              << std::setw(12) << std::setprecision(0) << m.allocations << " allocs";
+    if (baseline) {
+        std::cout << std::setw(8) << std::setprecision(2) << baseline->seconds / m.seconds << "x";
+    }
+    std::cout << "\n";
+}
+
+/**
+ * benchPayload - Runs every stage on a payload of items work orders.
+ * Returns false if the implementations disagree on the output.
+ */
+bool benchPayload(size_t items) {
+    std::string json = PayloadGenerator().generate(items);
+    std::cout << "Payload: " << items << " items, " << std::fixed << std::setprecision(2)
+              << json.size() / (1024.0 * 1024.0) << " MB\n";
+
+    size_t count = 0;
+    std::string pretty = JsonWriter::prettyPrint(json, &count);
+    bool same = count == items && pretty == legacyPrettyPrint(json);
+    pretty.clear();
+    pretty.shrink_to_fit();
+    std::cout << "Outputs identical: " << (same ? "yes" : "NO") << "\n\n";
+
+    Measurement legacy = measure([&] { return legacyPrettyPrint(json).size(); });
+    report("legacy prettyPrint", json.size(), items, legacy);
+    report("prettyPrint (single pass)", json.size(), items,
+           measure([&] { return JsonWriter::prettyPrint(json).size(); }), &legacy);
+    report("prettyPrint + count (single pass)", json.size(), items, measure([&] {
+        size_t n = 0;
+        return JsonWriter::prettyPrint(json, &n).size() + n;
+    }), &legacy);
+
+    std::string chunk;
+    report("JsonStreamFormatter (64 KB chunks)", json.size(), items, measure([&] {
+        JsonStreamFormatter formatter;
+        size_t total = 0;
+        for (size_t pos = 0; pos < json.size(); pos += 65536) {
+            chunk.clear();
+            formatter.feed(json.data() + pos, std::min<size_t>(65536, json.size() - pos), chunk);
+            total += chunk.size();
+        }
+        chunk.clear();
+        formatter.close(chunk);
+        return total + chunk.size() + formatter.itemCount();
+    }), &legacy);
+
+    report("decodeWorkOrdersBorrowed", json.size(), items, measure([&] { return decodeWorkOrdersBorrowed(json).items.size(); }));
+
+    WorkOrderBatch batch = decodeWorkOrdersBorrowed(json);
+    std::vector<WorkOrder>& workOrders = batch.items;
+    std::string out;
+    report("WorkOrderJson::append", json.size(), items, measure([&] {
+        out.clear();
+        WorkOrderJson::append(out, workOrders);
+        return out.size();
+    }));
+    out.clear();
+    out.shrink_to_fit();
+
+    std::vector<IndexCondition> conditions = {{IndexedField::Status, "InProgress"}, {IndexedField::Facility, "Main Shop"}};
+    auto scanQuery = [&] {
+        size_t matches = 0;
+        for (const WorkOrder& w : workOrders) {
+            matches += w.Status == "InProgress" && w.Facility == "Main Shop";
+        }
+        return matches;
+    };
+    Measurement scan = measure(scanQuery);
+    report("scan for Status + Facility", 0, items, scan);
+    report("WorkOrderIndex build", 0, items,
+           measure([&] { return WorkOrderIndex(workOrders).size(); }));
+    WorkOrderIndex workOrderIndex(workOrders);
+    same = same && workOrderIndex.query(conditions).size() == scanQuery();
+    report("WorkOrderIndex query", 0, items,
+           measure([&] { return workOrderIndex.query(conditions).size(); }), &scan);
+
+    Measurement structSum = measure([&] {
+        double total = 0;
+        for (const WorkOrder& w : workOrders) total += w.EstimatedCost.Value;
+        return static_cast<size_t>(total);
+    });
+    report("sum EstimatedCost over structs", 0, items, structSum);
+    report("WorkOrderColumns build", 0, items,
+           measure([&] { return WorkOrderColumns(workOrders).size(); }));
+    WorkOrderColumns columns(workOrders);
+    report("columnSum EstimatedCost", 0, items, measure([&] {
+        return static_cast<size_t>(columnSum(columns.EstimatedCost.Value.data(), columns.size()));
+    }), &structSum);
+
+    Measurement structAggregate = measure([&] {
+        std::map<std::pair<std::string, std::string>, AggregateStats> groups;
+        for (const WorkOrder& w : workOrders) {
+            for (const MoneyValue* m : {&w.EstimatedCost, &w.ActualCost, &w.GrandTotalPrice, &w.SalesTax,
+                                        &w.MarginVariance, &w.EstimatedMargin.Cash, &w.ActualMargin.Cash}) {
+                AggregateStats& stats = groups[{std::string(w.Facility), std::string(m->CurrencyCode)}];
+                stats.min = stats.count == 0 ? m->Value : std::min(stats.min, m->Value);
+                stats.max = stats.count == 0 ? m->Value : std::max(stats.max, m->Value);
+                stats.sum += m->Value;
+                stats.count++;
+            }
+        }
+        return groups.size();
+    });
+    report("aggregate by Facility over structs", 0, items, structAggregate);
+    std::vector<std::string> measures = WorkOrderAggregator::defaultMeasures();
+    report("WorkOrderAggregator by Facility", 0, items, measure([&] {
+        return WorkOrderAggregator(columns).aggregate("Facility", measures).stats.size();
+    }), &structAggregate);
+
+    std::vector<std::string> strings;
+    size_t stringBytes = 0;
+    for (const WorkOrder& w : workOrders) {
+        for (std::string_view str : {w.Name, w.Instructions, w.ProjectName, w.CreatedBy.FullName.view()}) {
+            strings.emplace_back(str);
+            stringBytes += str.size();
+        }
+    }
+    batch = WorkOrderBatch();
+
+    std::cout << "\n";
+    Measurement legacyEsc = measure([&] {
+        size_t total = 0;
+        for (const auto& str : strings) total += legacyEscape(str).size();
+        return total;
+    });
+    report("legacy escape", stringBytes, items, legacyEsc);
+    report("escape", stringBytes, items, measure([&] {
+        size_t total = 0;
+        for (const auto& str : strings) total += JsonWriter::escape(str).size();
+        return total;
+    }), &legacyEsc);
+    std::string buffer;
+    report("escapeTo (reused buffer)", stringBytes, items, measure([&] {
+        buffer.clear();
+        for (const auto& str : strings) JsonWriter::escapeTo(buffer, str);
+        return buffer.size();
+    }), &legacyEsc);
+
+    std::cout << "\n";
+    return same;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> sizes = {1000, 100000};
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.find("--sizes=") == 0) {
+            sizes.clear();
+            std::stringstream list(arg.substr(8));
+            std::string size;
+            while (std::getline(list, size, ',')) {
+                if (!size.empty()) sizes.push_back(std::stoull(size));
+            }
+        }
+    }
+
+    bool same = true;
+    for (size_t items : sizes) {
+        same = benchPayload(items) && same;
+    }
+    return same ? 0 : 1;
+}
@@ -0,0 +1,542 @@
+/**
+ * HTTP Server
+ *
+ * A deliberately small HTTP/1.1 server for local endpoints such as
+ * /metrics, the --serve daemon and the mock API server. It listens on a
+ * TCP address or on a Unix domain socket. It is not meant to face the
+ * internet: it speaks just enough HTTP for curl, Prometheus and browsers
+ * (GET requests, Content-Length or chunked response bodies, keep-alive)
+ * and nothing else. Request bodies are skipped: one with a
+ * Content-Length above 1 MB gets 413, a chunked one 501.
+ *
+ *   1. start() binds the socket and starts an accept thread
+ *   2. Every connection gets its own thread, which reads requests, calls
+ *      the handler and writes the responses until the client closes the
+ *      connection or asks for Connection: close
+ *   3. stop() (or the destructor) closes the listening socket and waits
+ *      for every connection thread to finish
+ *
+ * Header only, include it from work_orders.cpp and mock_server.cpp.
+ */
+
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace http_server_detail {
+
+/**
+ * percentDecode - Decodes %XX escapes and + (a space in query strings).
+ * A malformed escape is kept as it is.
+ */
+inline std::string percentDecode(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '+') {
+            out += ' ';
+        } else if (text[i] == '%' && i + 2 < text.size() && std::isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+                   std::isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            out += static_cast<char>(std::stoi(text.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            out += text[i];
+        }
+    }
+    return out;
+}
+
+}
+
+/**
+ * HttpRequest - One parsed request. Header names are lower case.
+ */
+struct HttpRequest {
+    std::string method;
+    std::string path;
+    std::string query;
+    std::map<std::string, std::string> headers;
+
+    std::string header(const std::string& name) const {
+        auto it = headers.find(name);
+        return it == headers.end() ? "" : it->second;
+    }
+
+    /**
+     * parameters - The name=value pairs of the query string, decoded, in
+     * order; a name may repeat.
+     */
+    std::vector<std::pair<std::string, std::string>> parameters() const {
+        std::vector<std::pair<std::string, std::string>> result;
+        size_t pos = 0;
+        while (pos < query.size()) {
+            size_t end = query.find('&', pos);
+            if (end == std::string::npos) end = query.size();
+            std::string pair = query.substr(pos, end - pos);
+            if (!pair.empty()) {
+                size_t equals = pair.find('=');
+                result.emplace_back(http_server_detail::percentDecode(pair.substr(0, equals)),
+                                    equals == std::string::npos ? "" : http_server_detail::percentDecode(pair.substr(equals + 1)));
+            }
+            pos = end + 1;
+        }
+        return result;
+    }
+};
+
+/**
+ * HttpResponse - What a handler sends back.
+ *
+ * sharedBody, if set, is sent instead of body; a large body that outlives
+ * the request, such as a cached snapshot, is then not copied per request.
+ * With chunkSize set the body is sent with Transfer-Encoding: chunked in
+ * pieces of that size, waiting chunkDelay between them, to imitate a
+ * server that produces its response gradually.
+ */
+struct HttpResponse {
+    int status = 200;
+    std::string contentType = "text/plain; charset=utf-8";
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    std::shared_ptr<const std::string> sharedBody;
+    size_t chunkSize = 0;
+    std::chrono::milliseconds chunkDelay{0};
+};
+
+using HttpHandler = std::function<HttpResponse(const HttpRequest&)>;
+
+namespace http_server_detail {
+
+inline const char* reasonPhrase(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Content Too Large";
+        case 429: return "Too Many Requests";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
+
+inline std::string lower(std::string s) {
+    for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+inline std::string trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+}
+
+class HttpServer {
+public:
+    /**
+     * HttpServer - Serves handler on host:port once start() is called.
+     * Port 0 picks a free port, see port().
+     */
+    HttpServer(std::string host, int port, HttpHandler handler)
+        : host(std::move(host)), requestedPort(port), handler(std::move(handler)) {}
+
+    /**
+     * HttpServer - Serves handler on the Unix domain socket at socketPath
+     * once start() is called. Only processes that may open the socket
+     * file can connect, which is the access control.
+     */
+    HttpServer(std::string socketPath, HttpHandler handler)
+        : socketPath(std::move(socketPath)), requestedPort(0), handler(std::move(handler)) {}
+
+    ~HttpServer() {
+        stop();
+    }
+
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+
+    /**
+     * start - Binds the listening socket and starts accepting. Throws if
+     * the address can't be used, e.g. because the port is taken.
+     */
+    void start() {
+        if (!socketPath.empty()) {
+            listenUnix();
+        } else {
+            listenTcp();
+        }
+
+        running = true;
+        acceptThread = std::thread([this] { acceptLoop(); });
+    }
+
+    /**
+     * stop - Stops accepting and waits for open connections to finish.
+     * Connection threads notice within one poll interval. A Unix socket
+     * file is removed.
+     */
+    void stop() {
+        if (!running.exchange(false)) return;
+
+        if (acceptThread.joinable()) acceptThread.join();
+        closeListener();
+        if (!socketPath.empty()) ::unlink(socketPath.c_str());
+
+        std::unique_lock<std::mutex> lock(connectionsMutex);
+        connectionsDone.wait(lock, [this] { return activeConnections == 0; });
+    }
+
+    /**
+     * port - The port actually bound, useful after asking for port 0; 0
+     * on a Unix socket.
+     */
+    int port() const {
+        return boundPort;
+    }
+
+private:
+    static constexpr int POLL_INTERVAL_MS = 200;
+    static constexpr size_t MAX_HEADER_BYTES = 64 * 1024;
+    static constexpr size_t MAX_BODY_BYTES = 1024 * 1024;
+
+    void listenTcp() {
+        listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) {
+            throw std::runtime_error(std::string("Failed to create socket: ") + std::strerror(errno));
+        }
+
+        int yes = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(requestedPort));
+        if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+            closeListener();
+            throw std::runtime_error("Invalid listen address: " + host);
+        }
+
+        if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(listenFd, 64) != 0) {
+            std::string message = std::strerror(errno);
+            closeListener();
+            throw std::runtime_error("Failed to listen on " + host + ":" + std::to_string(requestedPort) + ": " + message);
+        }
+
+        socklen_t length = sizeof(address);
+        getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length);
+        boundPort = ntohs(address.sin_port);
+    }
+
+    /**
+     * listenUnix - Binds socketPath. A socket file left behind by a process
+     * that didn't stop cleanly is replaced, anything else at that path is
+     * an error. The socket is readable and writable by owner and group.
+     */
+    void listenUnix() {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Socket path too long: " + socketPath);
+        }
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+        struct stat existing;
+        if (::lstat(socketPath.c_str(), &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode)) {
+                throw std::runtime_error("Not a socket, refusing to replace: " + socketPath);
+            }
+            ::unlink(socketPath.c_str());
+        }
+
+        listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) {
+            throw std::runtime_error(std::string("Failed to create socket: ") + std::strerror(errno));
+        }
+
+        if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::chmod(socketPath.c_str(), 0660) != 0 || ::listen(listenFd, 64) != 0) {
+            std::string message = std::strerror(errno);
+            closeListener();
+            throw std::runtime_error("Failed to listen on " + socketPath + ": " + message);
+        }
+    }
+
+    void closeListener() {
+        if (listenFd >= 0) {
+            ::close(listenFd);
+            listenFd = -1;
+        }
+    }
+
+    void acceptLoop() {
+        while (running) {
+            pollfd pfd{listenFd, POLLIN, 0};
+            if (::poll(&pfd, 1, POLL_INTERVAL_MS) <= 0) continue;
+
+            int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) continue;
+
+            {
+                std::lock_guard<std::mutex> lock(connectionsMutex);
+                activeConnections++;
+            }
+            std::thread([this, fd] {
+                serveConnection(fd);
+                ::close(fd);
+                std::lock_guard<std::mutex> lock(connectionsMutex);
+                activeConnections--;
+                connectionsDone.notify_all();
+            }).detach();
+        }
+    }
+
+    /**
+     * receive - Waits for data on fd and reads up to size bytes of it,
+     * checking running between polls so stop() never waits for a client
+     * that stalls. Returns the number of bytes read, 0 if the connection
+     * closed or failed or the server is stopping.
+     */
+    size_t receive(int fd, char* data, size_t size) {
+        while (running) {
+            pollfd pfd{fd, POLLIN, 0};
+            int ready = ::poll(&pfd, 1, POLL_INTERVAL_MS);
+            if (ready == 0) continue;
+            if (ready < 0 && errno == EINTR) continue;
+            if (ready < 0) return 0;
+
+            ssize_t n = ::recv(fd, data, size, 0);
+            return n > 0 ? static_cast<size_t>(n) : 0;
+        }
+        return 0;
+    }
+
+    /**
+     * sendAll - Writes the whole buffer, waiting with poll while the
+     * client's receive window is full and checking running between polls
+     * like receive(), so a client that stops reading can't hold stop()
+     * up. MSG_DONTWAIT keeps a large send from blocking past the poll;
+     * MSG_NOSIGNAL keeps a client that went away from killing the process
+     * with SIGPIPE. Returns false if the connection failed or the server
+     * is stopping.
+     */
+    bool sendAll(int fd, const char* data, size_t size) {
+        while (size > 0) {
+            if (!running) return false;
+            ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+                pollfd pfd{fd, POLLOUT, 0};
+                if (::poll(&pfd, 1, POLL_INTERVAL_MS) < 0 && errno != EINTR) return false;
+                continue;
+            }
+            data += sent;
+            size -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+
+    /**
+     * readRequest - Reads one request head from fd into request and skips
+     * its body. Leftover bytes of a pipelined next request stay in buffer.
+     * Returns false when the connection should be closed; if the request
+     * can't be served, errorStatus is then the status to answer with
+     * first (400, 413 or 501).
+     */
+    bool readRequest(int fd, std::string& buffer, HttpRequest& request, int& errorStatus) {
+        size_t headerEnd;
+        while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+            if (buffer.size() > MAX_HEADER_BYTES) return false;
+
+            char chunk[4096];
+            size_t n = receive(fd, chunk, sizeof(chunk));
+            if (n == 0) return false;
+            buffer.append(chunk, n);
+        }
+
+        std::string head = buffer.substr(0, headerEnd);
+        buffer.erase(0, headerEnd + 4);
+
+        size_t lineEnd = head.find("\r\n");
+        std::string requestLine = head.substr(0, lineEnd);
+        size_t firstSpace = requestLine.find(' ');
+        size_t secondSpace = requestLine.find(' ', firstSpace + 1);
+        if (firstSpace == std::string::npos || secondSpace == std::string::npos) return false;
+
+        request = HttpRequest();
+        request.method = requestLine.substr(0, firstSpace);
+        std::string target = requestLine.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+        size_t question = target.find('?');
+        request.path = target.substr(0, question);
+        if (question != std::string::npos) request.query = target.substr(question + 1);
+        if (requestLine.compare(secondSpace + 1, std::string::npos, "HTTP/1.0") == 0) {
+            request.headers["connection"] = "close";
+        }
+
+        size_t pos = lineEnd == std::string::npos ? head.size() : lineEnd + 2;
+        while (pos < head.size()) {
+            size_t end = head.find("\r\n", pos);
+            if (end == std::string::npos) end = head.size();
+            std::string line = head.substr(pos, end - pos);
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                request.headers[http_server_detail::lower(line.substr(0, colon))] =
+                    http_server_detail::trim(line.substr(colon + 1));
+            }
+            pos = end + 2;
+        }
+
+        // Bodies are not used by any handler, but must be skipped so the
+        // next request on this connection starts at the right byte
+        if (!request.header("transfer-encoding").empty()) {
+            errorStatus = 501;
+            return false;
+        }
+        std::string length = request.header("content-length");
+        if (length.find_first_not_of("0123456789") != std::string::npos) {
+            errorStatus = 400;
+            return false;
+        }
+        // strtoull saturates, so a length too long to parse is too large
+        size_t remaining = std::strtoull(length.c_str(), nullptr, 10);
+        if (remaining > MAX_BODY_BYTES) {
+            errorStatus = 413;
+            return false;
+        }
+
+        size_t buffered = std::min(remaining, buffer.size());
+        buffer.erase(0, buffered);
+        remaining -= buffered;
+        while (remaining > 0) {
+            char chunk[4096];
+            size_t n = receive(fd, chunk, sizeof(chunk));
+            if (n == 0) return false;
+            if (n > remaining) buffer.append(chunk + remaining, n - remaining);
+            remaining -= std::min(n, remaining);
+        }
+        return true;
+    }
+
+    /**
+     * sendError - Answers a request that readRequest rejected; the
+     * connection is closed right after.
+     */
+    void sendError(int fd, int status) {
+        std::string body = std::string(http_server_detail::reasonPhrase(status)) + "\n";
+        std::string response = "HTTP/1.1 " + std::to_string(status) + " " + http_server_detail::reasonPhrase(status) +
+                               "\r\nContent-Type: text/plain; charset=utf-8\r\nContent-Length: " +
+                               std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        sendAll(fd, response.data(), response.size());
+    }
+
+    void serveConnection(int fd) {
+        std::string buffer;
+        HttpRequest request;
+        int errorStatus = 0;
+
+        while (readRequest(fd, buffer, request, errorStatus)) {
+            HttpResponse response;
+            try {
+                response = handler(request);
+            } catch (const std::exception& e) {
+                response = HttpResponse();
+                response.status = 500;
+                response.body = std::string(e.what()) + "\n";
+            }
+
+            const std::string& body = response.sharedBody ? *response.sharedBody : response.body;
+            bool close = http_server_detail::lower(request.header("connection")) == "close";
+            bool chunked = response.chunkSize > 0;
+            std::string head = "HTTP/1.1 " + std::to_string(response.status) + " " +
+                               http_server_detail::reasonPhrase(response.status) + "\r\n";
+            head += "Content-Type: " + response.contentType + "\r\n";
+            head += chunked ? std::string("Transfer-Encoding: chunked\r\n")
+                            : "Content-Length: " + std::to_string(body.size()) + "\r\n";
+            for (const auto& header : response.headers) {
+                head += header.first + ": " + header.second + "\r\n";
+            }
+            head += close ? "Connection: close\r\n\r\n" : "\r\n";
+
+            bool sendBody = request.method != "HEAD" && response.status != 304;
+            if (!sendAll(fd, head.data(), head.size())) return;
+            if (sendBody) {
+                bool sent = chunked ? sendChunked(fd, body, response)
+                                    : sendAll(fd, body.data(), body.size());
+                if (!sent) return;
+            }
+            if (close) return;
+        }
+
+        if (errorStatus != 0) sendError(fd, errorStatus);
+    }
+
+    /**
+     * sendChunked - Sends body in response.chunkSize pieces, each as its
+     * own chunk, followed by the terminating empty chunk.
+     */
+    bool sendChunked(int fd, const std::string& body, const HttpResponse& response) {
+        for (size_t pos = 0; pos < body.size(); pos += response.chunkSize) {
+            if (pos > 0 && response.chunkDelay.count() > 0) {
+                std::this_thread::sleep_for(response.chunkDelay);
+            }
+            size_t size = std::min(response.chunkSize, body.size() - pos);
+            char sizeLine[32];
+            int length = std::snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", size);
+            if (!sendAll(fd, sizeLine, static_cast<size_t>(length)) ||
+                !sendAll(fd, body.data() + pos, size) ||
+                !sendAll(fd, "\r\n", 2)) {
+                return false;
+            }
+        }
+        return sendAll(fd, "0\r\n\r\n", 5);
+    }
+
+    std::string host;
+    std::string socketPath;
+    int requestedPort;
+    HttpHandler handler;
+    int listenFd = -1;
+    int boundPort = 0;
+    std::atomic<bool> running{false};
+    std::thread acceptThread;
+    std::mutex connectionsMutex;
+    std::condition_variable connectionsDone;
+    int activeConnections = 0;
+};
+
+#endif
@@ -0,0 +1,851 @@
+/**
+ * Innergy API Client
+ *
+ * A reusable client that keeps cURL handles (and the connections they hold)
+ * alive between calls. Every call to the old fetchWorkOrders paid for DNS,
+ * TCP and TLS again; the client keeps a pool of warm easy handles and shares
+ * the DNS cache, TLS session cache and connection cache between them through
+ * a CURLSH share handle, so repeated fetches reuse the same connection.
+ *
+ * Header only, include it from work_orders.cpp.
+ */
+
+#ifndef INNERGY_CLIENT_H
+#define INNERGY_CLIENT_H
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <curl/curl.h>
+
+#include "rate_limiter.h"
+#include "retry_policy.h"
+
+/**
+ * writeCallback - Callback function for cURL to handle response data.
+ *
+ *   1. cURL calls this function each time it receives a chunk of data
+ *   2. The data comes as a void pointer with size information
+ *   3. We calculate the total size * nmemb
+ *   4. Cast the void pointer to char* and append to our response string
+ *   5. Return the number of bytes processed. cURL expects this
+ *
+ * Data arrives in chunks, not all at once, so we accumulate it.
+ */
+inline size_t writeCallback(void* contents, size_t size, size_t nmemb, std::string* response) {
+    size_t totalSize = size * nmemb;
+    response->append((char*)contents, totalSize);
+    return totalSize;
+}
+
+/**
+ * Validators - The ETag and Last-Modified headers of a response.
+ *
+ * Sent back as If-None-Match and If-Modified-Since, they let the server
+ * answer 304 Not Modified instead of sending a body we already have.
+ */
+struct Validators {
+    std::string etag;
+    std::string lastModified;
+
+    bool empty() const {
+        return etag.empty() && lastModified.empty();
+    }
+};
+
+/**
+ * ChunkSink - Receives the response body one chunk at a time, as cURL
+ * delivers it, e.g. to feed a JsonStreamParser.
+ */
+using ChunkSink = std::function<void(const char* data, size_t size)>;
+
+/**
+ * TransferStats - How many bytes a response took on the wire and after
+ * decoding. cURL decompresses gzip, deflate, br and zstd bodies (whatever
+ * it was built with) before they reach the write callback, so the two
+ * differ by the compression ratio.
+ */
+struct TransferStats {
+    std::string encoding;
+    curl_off_t wireBytes = 0;
+    curl_off_t bodyBytes = 0;
+};
+
+/**
+ * TransferTiming - Where the time of a request went, as measured by cURL.
+ *
+ * The phase times are microseconds since the request started and each one
+ * includes the phases before it, the way cURL reports them: a slow DNS
+ * server shows up in nameLookup and in everything after it. On a reused
+ * connection nameLookup, connect and appConnect are close to 0; appConnect
+ * (the TLS handshake) is 0 for plain http.
+ */
+struct TransferTiming {
+    curl_off_t nameLookup = 0;
+    curl_off_t connect = 0;
+    curl_off_t appConnect = 0;
+    curl_off_t startTransfer = 0;
+    curl_off_t total = 0;
+    curl_off_t bytesPerSecond = 0;
+};
+
+/**
+ * FetchResult - Outcome of one HTTP request.
+ *
+ * Failures are stored rather than thrown so that one failing endpoint in a
+ * concurrent batch does not hide the results of the others. retries is
+ * the number of attempts that failed before this one; queueWait is how
+ * long this attempt waited for the rate limiter.
+ */
+struct FetchResult {
+    std::string endpoint;
+    long httpCode = 0;
+    CURLcode curlCode = CURLE_OK;
+    std::string body;
+    Validators validators;
+    std::string retryAfter;
+    int retries = 0;
+    std::chrono::nanoseconds queueWait{0};
+    TransferStats stats;
+    TransferTiming timing;
+
+    bool ok() const {
+        return curlCode == CURLE_OK && httpCode >= 200 && httpCode < 300;
+    }
+
+    /**
+     * notModified - True for a 304 answer to a conditional request; the
+     * body we already have is still current.
+     */
+    bool notModified() const {
+        return curlCode == CURLE_OK && httpCode == 304;
+    }
+
+    std::string error() const {
+        std::string suffix = retries > 0 ? " after " + std::to_string(retries) + " retries" : "";
+        if (curlCode != CURLE_OK) {
+            return std::string("cURL error: ") + curl_easy_strerror(curlCode) + suffix;
+        }
+        if (httpCode < 200 || httpCode >= 300) {
+            return "API returned status " + std::to_string(httpCode) + suffix;
+        }
+        return "";
+    }
+};
+
+/**
+ * TransferObserver - Called with the result of every finished transfer.
+ */
+using TransferObserver = std::function<void(const FetchResult&)>;
+
+/**
+ * headerCallback - Callback function for cURL to handle response headers.
+ *
+ *   1. cURL calls this once per header line, including the status line
+ *   2. A status line starts a new response (after a redirect or a
+ *      100 Continue), so the headers seen so far are dropped
+ *   3. ETag, Last-Modified, Content-Encoding and Retry-After are stored,
+ *      names compared case-insensitively
+ *   4. Returns the number of bytes processed, like writeCallback
+ */
+inline size_t headerCallback(char* buffer, size_t size, size_t nitems, FetchResult* result) {
+    size_t totalSize = size * nitems;
+    std::string_view line(buffer, totalSize);
+
+    if (line.compare(0, 5, "HTTP/") == 0) {
+        result->validators = Validators();
+        result->stats.encoding.clear();
+        result->retryAfter.clear();
+        return totalSize;
+    }
+
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos) return totalSize;
+
+    std::string name;
+    for (char c : line.substr(0, colon)) {
+        name += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+
+    std::string_view value = line.substr(colon + 1);
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+    while (!value.empty() && (value.back() == '\r' || value.back() == '\n' || value.back() == ' ')) value.remove_suffix(1);
+
+    if (name == "etag") {
+        result->validators.etag = value;
+    } else if (name == "last-modified") {
+        result->validators.lastModified = value;
+    } else if (name == "content-encoding") {
+        result->stats.encoding = value;
+    } else if (name == "retry-after") {
+        result->retryAfter = value;
+    }
+    return totalSize;
+}
+
+/**
+ * InnergyClient - Owns a pool of warm cURL handles for the Innergy API.
+ *
+ *   1. The constructor creates a CURLSH share handle that shares DNS,
+ *      TLS sessions and open connections between all handles in the pool
+ *   2. The header list (Accept + Api-Key) is built once and reused
+ *   3. acquire() hands out an idle handle, or creates one if none are idle
+ *   4. release() puts the handle back so its connection stays open;
+ *      handles beyond poolSize are cleaned up instead
+ *   5. fetch() runs one blocking GET using a pooled handle
+ *   6. fetchIfChanged() and fetchStreaming() can send the validators of
+ *      an earlier response, so an unchanged resource costs a 304 and no
+ *      body
+ *   7. An observer set with setObserver() sees the result of every
+ *      transfer, failed ones included, before anything is thrown
+ *   8. Transient failures (timeouts, 429, 5xx) are retried according to
+ *      the RetryPolicy set with setRetryPolicy(); the observer sees every
+ *      attempt
+ *   9. With a RateLimiter set by setRateLimiter(), every attempt first
+ *      waits for a slot in the bucket of our host and API key
+ *   10. cancel() aborts running transfers and retry waits, e.g. to shut
+ *       down without waiting out a deadline
+ *
+ * The client is safe to use from several threads at once. The share
+ * handle is protected by one mutex per shared data type.
+ */
+class InnergyClient {
+public:
+    static constexpr const char* DEFAULT_BASE_URL = "https://app.innergy.com/api/";
+
+    explicit InnergyClient(const std::string& apiKey, size_t poolSize = 4)
+        : poolSize(poolSize), apiKey(apiKey) {
+        share = curl_share_init();
+        if (!share) {
+            throw std::runtime_error("Failed to initialize cURL share handle");
+        }
+
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockCallback);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockCallback);
+        curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+        headers = curl_slist_append(headers, "Accept: application/json");
+        std::string apiKeyHeader = "Api-Key: " + apiKey;
+        headers = curl_slist_append(headers, apiKeyHeader.c_str());
+    }
+
+    ~InnergyClient() {
+        for (CURL* curl : idle) {
+            curl_easy_cleanup(curl);
+        }
+        curl_share_cleanup(share);
+        curl_slist_free_all(headers);
+    }
+
+    InnergyClient(const InnergyClient&) = delete;
+    InnergyClient& operator=(const InnergyClient&) = delete;
+
+    /**
+     * acquire - Takes a warm handle from the pool, or creates a new one.
+     *
+     * New handles are attached to the share handle and have TCP keepalive
+     * enabled so idle connections survive between polls.
+     */
+    CURL* acquire() {
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            if (!idle.empty()) {
+                CURL* curl = idle.back();
+                idle.pop_back();
+                return curl;
+            }
+        }
+
+        CURL* curl = curl_easy_init();
+        if (!curl) {
+            throw std::runtime_error("Failed to initialize cURL");
+        }
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 300L);
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progressCallback);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, this);
+        return curl;
+    }
+
+    /**
+     * release - Returns a handle to the pool once its transfer is finished.
+     */
+    void release(CURL* curl) {
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            if (idle.size() < poolSize) {
+                idle.push_back(curl);
+                return;
+            }
+        }
+        curl_easy_cleanup(curl);
+    }
+
+    /**
+     * prepare - Configures a pooled handle to GET an endpoint into result.
+     *
+     * Shared by the blocking fetch() and by MultiFetcher, so both paths
+     * send the same headers and use the same callback and timeout.
+     */
+    void prepare(CURL* curl, const std::string& endpoint, FetchResult* result) {
+        result->endpoint = endpoint;
+        std::string url = baseUrl + endpoint;
+
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &result->body);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, headerCallback);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, result);
+        // "" offers every encoding this cURL can decode; bodies are
+        // decompressed chunk by chunk on their way to the write callback
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, static_cast<long>(REQUEST_TIMEOUT.count()));
+    }
+
+    /**
+     * retrySchedule - Starts the retry schedule of a new request, and with
+     * it the deadline of all its attempts.
+     */
+    RetrySchedule retrySchedule() const {
+        return RetrySchedule(retryPolicy);
+    }
+
+    /**
+     * limitTimeout - Cuts the timeout of a prepared handle to what is left
+     * of the request's deadline.
+     */
+    void limitTimeout(CURL* curl, const RetrySchedule& schedule) const {
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, static_cast<long>(schedule.attemptTimeout(REQUEST_TIMEOUT).count()));
+    }
+
+    /**
+     * complete - Records the outcome of a finished transfer in result:
+     * status, byte counts and the timing of each phase.
+     */
+    void complete(CURL* curl, CURLcode res, FetchResult* result) {
+        result->curlCode = res;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &result->httpCode);
+        curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &result->stats.wireBytes);
+        result->stats.bodyBytes = static_cast<curl_off_t>(result->body.size());
+
+        TransferTiming& timing = result->timing;
+        curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &timing.nameLookup);
+        curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &timing.connect);
+        curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &timing.appConnect);
+        curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &timing.startTransfer);
+        curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &timing.total);
+        curl_easy_getinfo(curl, CURLINFO_SPEED_DOWNLOAD_T, &timing.bytesPerSecond);
+    }
+
+    /**
+     * setBaseUrl - Sends requests to url instead of DEFAULT_BASE_URL, e.g.
+     * to a local mock server. A missing trailing slash is added.
+     */
+    void setBaseUrl(const std::string& url) {
+        baseUrl = url;
+        if (baseUrl.empty() || baseUrl.back() != '/') baseUrl += '/';
+        if (limiter) bucket = &limiter->bucket(RateLimiter::hostOf(baseUrl), apiKey);
+    }
+
+    /**
+     * currentBaseUrl / currentApiKey - Where requests go, with the trailing
+     * slash, and the key they are made with.
+     */
+    const std::string& currentBaseUrl() const {
+        return baseUrl;
+    }
+
+    const std::string& currentApiKey() const {
+        return apiKey;
+    }
+
+    /**
+     * setRateLimiter - Paces every request through limiter's bucket for
+     * our host and API key. Clients sharing one limiter share the budget;
+     * nullptr turns pacing off. Set it before the client is used.
+     */
+    void setRateLimiter(std::shared_ptr<RateLimiter> limiter) {
+        this->limiter = std::move(limiter);
+        bucket = this->limiter ? &this->limiter->bucket(RateLimiter::hostOf(baseUrl), apiKey) : nullptr;
+    }
+
+    /**
+     * reserveSlot - Reserves the rate limiter slot of the next request and
+     * returns how long to wait for it; zero without a rate limiter.
+     */
+    std::chrono::nanoseconds reserveSlot() {
+        return bucket ? bucket->reserve() : std::chrono::nanoseconds(0);
+    }
+
+    /**
+     * setRetryPolicy - Replaces the default policy (3 retries within 5
+     * minutes); maxRetries 0 turns retrying off.
+     */
+    void setRetryPolicy(const RetryPolicy& policy) {
+        retryPolicy = policy;
+    }
+
+    /**
+     * setObserver - Calls observer with the FetchResult of every finished
+     * transfer, e.g. to record metrics. It runs on the thread that drove
+     * the transfer; set it before the client is used.
+     */
+    void setObserver(TransferObserver observer) {
+        this->observer = std::move(observer);
+    }
+
+    /**
+     * cancel - Aborts every running transfer of this client and wakes up
+     * requests that wait for a retry or a rate limiter slot; they throw
+     * instead. The client can't be used for new requests afterwards.
+     */
+    void cancel() {
+        {
+            std::lock_guard<std::mutex> lock(cancelMutex);
+            cancelled = true;
+        }
+        cancelWake.notify_all();
+    }
+
+    /**
+     * notify - Hands a finished transfer to the observer, if there is one.
+     */
+    void notify(const FetchResult& result) const {
+        if (observer) observer(result);
+    }
+
+    /**
+     * fetch - Makes an HTTP GET request to an Innergy API endpoint.
+     *
+     *   1. Leases a warm handle from the pool
+     *   2. Points it at baseUrl + endpoint with our shared headers
+     *   3. Executes the request with curl_easy_perform
+     *   4. Returns the handle to the pool, keeping the connection open
+     *   5. Throws on cURL errors and on non-2xx status codes
+     */
+    std::string fetch(const std::string& endpoint) {
+        return std::move(fetchIfChanged(endpoint, Validators()).body);
+    }
+
+    /**
+     * fetchIfChanged - Like fetch(), but sends the validators of an earlier
+     * response and returns the whole FetchResult.
+     *
+     * The result is either ok() with the new body and its validators, or
+     * notModified() with no body. Transient failures are retried first;
+     * anything else throws like fetch().
+     */
+    FetchResult fetchIfChanged(const std::string& endpoint, const Validators& since) {
+        HeaderList conditional = conditionalHeaders(since);
+        RetrySchedule schedule = retrySchedule();
+
+        while (true) {
+            std::chrono::nanoseconds queueWait = reserveSlot();
+            pause(queueWait);
+            CURL* curl = acquire();
+
+            FetchResult result;
+            result.retries = schedule.retries();
+            result.queueWait = queueWait;
+            prepare(curl, endpoint, &result);
+            limitTimeout(curl, schedule);
+            if (conditional) {
+                curl_easy_setopt(curl, CURLOPT_HTTPHEADER, conditional.get());
+            }
+            CURLcode res = curl_easy_perform(curl);
+            complete(curl, res, &result);
+            notify(result);
+
+            release(curl);
+
+            if (result.ok() || result.notModified()) {
+                return result;
+            }
+
+            std::chrono::milliseconds wait;
+            if (!schedule.next(result.curlCode, result.httpCode, result.retryAfter, wait)) {
+                throw std::runtime_error(result.error());
+            }
+            pause(wait);
+        }
+    }
+
+    /**
+     * fetchStreaming - Like fetch(), but hands the body to sink chunk by
+     * chunk instead of collecting it in one string.
+     *
+     *   1. Sets up the handle like fetch() does
+     *   2. Swaps the write callback for streamCallback
+     *   3. Error responses (non-2xx) are collected in a string instead of
+     *      being passed to the sink, so the sink only ever sees real data
+     *   4. If the sink throws, the transfer is aborted and the exception
+     *      is rethrown here once the handle is back in the pool
+     *   5. With validators in since the request is conditional like in
+     *      fetchIfChanged(); on a 304 the sink is never called
+     *   6. Transient failures are retried like in fetchIfChanged(), but
+     *      only while the sink hasn't seen any data; chunks it has already
+     *      consumed can't be taken back
+     *
+     * Returns the status and validators of the response, without the body.
+     */
+    FetchResult fetchStreaming(const std::string& endpoint, const ChunkSink& sink,
+                               const Validators& since = Validators()) {
+        HeaderList conditional = conditionalHeaders(since);
+        RetrySchedule schedule = retrySchedule();
+
+        while (true) {
+            std::chrono::nanoseconds queueWait = reserveSlot();
+            pause(queueWait);
+            CURL* curl = acquire();
+
+            FetchResult result;
+            result.retries = schedule.retries();
+            result.queueWait = queueWait;
+            StreamTarget target{curl, &sink, &result, nullptr, 0};
+            prepare(curl, endpoint, &result);
+            limitTimeout(curl, schedule);
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, streamCallback);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &target);
+            if (conditional) {
+                curl_easy_setopt(curl, CURLOPT_HTTPHEADER, conditional.get());
+            }
+            CURLcode res = curl_easy_perform(curl);
+            complete(curl, res, &result);
+            result.stats.bodyBytes += target.streamed;
+            notify(result);
+
+            release(curl);
+
+            if (target.error) {
+                std::rethrow_exception(target.error);
+            }
+
+            if (result.ok() || result.notModified()) {
+                return result;
+            }
+
+            std::chrono::milliseconds wait;
+            if (target.streamed > 0 || !schedule.next(result.curlCode, result.httpCode, result.retryAfter, wait)) {
+                throw std::runtime_error(result.error());
+            }
+            pause(wait);
+        }
+    }
+
+    /**
+     * fetchWorkOrders - Fetches the projectWorkOrders endpoint.
+     */
+    std::string fetchWorkOrders() {
+        return fetch("projectWorkOrders");
+    }
+
+private:
+    static constexpr std::chrono::milliseconds REQUEST_TIMEOUT{120000};
+
+    using HeaderList = std::unique_ptr<struct curl_slist, decltype(&curl_slist_free_all)>;
+
+    /**
+     * pause - Sleeps for wait, unless cancel() is called first; then, or
+     * if it already was, throws.
+     */
+    void pause(std::chrono::nanoseconds wait) {
+        std::unique_lock<std::mutex> lock(cancelMutex);
+        if (cancelWake.wait_for(lock, wait, [this] { return cancelled.load(); })) {
+            throw std::runtime_error("Request cancelled");
+        }
+    }
+
+    /**
+     * progressCallback - Aborts the transfer once the client is cancelled.
+     * cURL calls it about once a second while a transfer runs, and more
+     * often while data flows.
+     */
+    static int progressCallback(void* clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+        return static_cast<InnergyClient*>(clientp)->cancelled ? 1 : 0;
+    }
+
+    /**
+     * conditionalHeaders - Our shared headers plus If-None-Match and
+     * If-Modified-Since for the given validators. Empty if there are none,
+     * then the shared list is used as is.
+     */
+    HeaderList conditionalHeaders(const Validators& since) const {
+        HeaderList list(nullptr, curl_slist_free_all);
+        if (since.empty()) return list;
+
+        struct curl_slist* raw = nullptr;
+        for (struct curl_slist* item = headers; item; item = item->next) {
+            raw = curl_slist_append(raw, item->data);
+        }
+        if (!since.etag.empty()) {
+            raw = curl_slist_append(raw, ("If-None-Match: " + since.etag).c_str());
+        }
+        if (!since.lastModified.empty()) {
+            raw = curl_slist_append(raw, ("If-Modified-Since: " + since.lastModified).c_str());
+        }
+        list.reset(raw);
+        return list;
+    }
+
+    struct StreamTarget {
+        CURL* curl;
+        const ChunkSink* sink;
+        FetchResult* result;
+        std::exception_ptr error;
+        curl_off_t streamed;
+    };
+
+    /**
+     * streamCallback - Write callback used by fetchStreaming.
+     *
+     * Exceptions must not travel through cURL's C code, so they are caught,
+     * stored, and the transfer is stopped by returning 0.
+     */
+    static size_t streamCallback(void* contents, size_t size, size_t nmemb, StreamTarget* target) {
+        size_t totalSize = size * nmemb;
+
+        long httpCode = 0;
+        curl_easy_getinfo(target->curl, CURLINFO_RESPONSE_CODE, &httpCode);
+        if (httpCode < 200 || httpCode >= 300) {
+            target->result->body.append((char*)contents, totalSize);
+            return totalSize;
+        }
+
+        target->streamed += static_cast<curl_off_t>(totalSize);
+        try {
+            (*target->sink)((const char*)contents, totalSize);
+        } catch (...) {
+            target->error = std::current_exception();
+            return 0;
+        }
+        return totalSize;
+    }
+
+    static void lockCallback(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+        static_cast<InnergyClient*>(userptr)->shareLocks[data].lock();
+    }
+
+    static void unlockCallback(CURL*, curl_lock_data data, void* userptr) {
+        static_cast<InnergyClient*>(userptr)->shareLocks[data].unlock();
+    }
+
+    size_t poolSize;
+    std::string apiKey;
+    std::string baseUrl = DEFAULT_BASE_URL;
+    RetryPolicy retryPolicy;
+    std::shared_ptr<RateLimiter> limiter;
+    TokenBucket* bucket = nullptr;
+    TransferObserver observer;
+    CURLSH* share = nullptr;
+    struct curl_slist* headers = nullptr;
+    std::mutex poolMutex;
+    std::vector<CURL*> idle;
+    std::mutex shareLocks[CURL_LOCK_DATA_LAST];
+    std::atomic<bool> cancelled{false};
+    std::mutex cancelMutex;
+    std::condition_variable cancelWake;
+};
+
+/**
+ * MultiFetcher - Runs several endpoint requests at once on one thread.
+ *
+ *   1. add() queues an endpoint together with its completion callback
+ *   2. run() attaches a pooled handle per endpoint to one CURLM multi handle
+ *   3. A single event loop calls curl_multi_perform and then waits in
+ *      curl_multi_poll until any socket has data
+ *   4. Each finished transfer is read with curl_multi_info_read, its
+ *      handle goes back to the client pool, and its callback is invoked
+ *   5. A transfer that failed transiently is not reported yet; it waits
+ *      out its retry delay and is added to the multi handle again, while
+ *      the other transfers keep running
+ *   6. With a rate limiter, a transfer whose slot isn't due yet waits the
+ *      same way before it is added
+ *
+ * No thread per request is needed: a batch takes about as long as its
+ * slowest request instead of the sum of all of them. Over HTTP/2 the
+ * requests are multiplexed on one connection.
+ */
+class MultiFetcher {
+public:
+    using Callback = std::function<void(FetchResult&)>;
+
+    explicit MultiFetcher(InnergyClient& client) : client(client) {
+        multi = curl_multi_init();
+        if (!multi) {
+            throw std::runtime_error("Failed to initialize cURL multi handle");
+        }
+        curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    }
+
+    ~MultiFetcher() {
+        for (auto& transfer : transfers) {
+            if (transfer->curl) {
+                curl_multi_remove_handle(multi, transfer->curl);
+                client.release(transfer->curl);
+            }
+        }
+        curl_multi_cleanup(multi);
+    }
+
+    MultiFetcher(const MultiFetcher&) = delete;
+    MultiFetcher& operator=(const MultiFetcher&) = delete;
+
+    /**
+     * add - Queues a request for endpoint. onComplete runs on the thread
+     * that calls run(), once the transfer has finished or failed.
+     */
+    void add(const std::string& endpoint, Callback onComplete) {
+        auto transfer = std::make_unique<Transfer>();
+        transfer->endpoint = endpoint;
+        transfer->onComplete = std::move(onComplete);
+        transfers.push_back(std::move(transfer));
+    }
+
+    /**
+     * run - Drives every queued transfer to completion, retries included.
+     *
+     * While retries or rate limited starts are waiting, the loop wakes up
+     * in time for the earliest one instead of after the usual second.
+     */
+    void run() {
+        for (auto& transfer : transfers) {
+            transfer->schedule = std::make_unique<RetrySchedule>(client.retrySchedule());
+            start(*transfer);
+        }
+
+        int running = 0;
+        while (true) {
+            startDueRetries();
+
+            CURLMcode mc = curl_multi_perform(multi, &running);
+            if (mc != CURLM_OK) {
+                throw std::runtime_error(std::string("cURL multi error: ") + curl_multi_strerror(mc));
+            }
+
+            drainCompleted();
+
+            auto timeout = std::chrono::milliseconds(1000);
+            bool waiting = false;
+            for (auto& transfer : transfers) {
+                if (!transfer->waiting) continue;
+                waiting = true;
+                auto untilRetry = std::chrono::duration_cast<std::chrono::milliseconds>(transfer->retryAt - Clock::now());
+                timeout = std::max(std::chrono::milliseconds(0), std::min(timeout, untilRetry));
+            }
+
+            if (running == 0 && !waiting) break;
+            if (running > 0) {
+                curl_multi_poll(multi, nullptr, 0, static_cast<int>(timeout.count()), nullptr);
+            } else {
+                std::this_thread::sleep_for(timeout);
+            }
+        }
+
+        transfers.clear();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Transfer {
+        std::string endpoint;
+        Callback onComplete;
+        CURL* curl = nullptr;
+        FetchResult result;
+        std::unique_ptr<RetrySchedule> schedule;
+        bool waiting = false;
+        Clock::time_point retryAt;
+        bool slotReserved = false;
+        std::chrono::nanoseconds queueWait{0};
+    };
+
+    /**
+     * start - Adds an attempt of transfer to the multi handle.
+     *
+     * The attempt first reserves its rate limiter slot. If the slot is
+     * still ahead, the transfer waits like a retry and start() is called
+     * again when the slot is due, without reserving another one.
+     */
+    void start(Transfer& transfer) {
+        if (!transfer.slotReserved) {
+            transfer.queueWait = client.reserveSlot();
+            if (transfer.queueWait.count() > 0) {
+                transfer.slotReserved = true;
+                transfer.waiting = true;
+                transfer.retryAt = Clock::now() + std::chrono::duration_cast<Clock::duration>(transfer.queueWait);
+                return;
+            }
+        }
+        transfer.slotReserved = false;
+
+        transfer.result = FetchResult();
+        transfer.result.retries = transfer.schedule->retries();
+        transfer.result.queueWait = transfer.queueWait;
+        transfer.curl = client.acquire();
+        client.prepare(transfer.curl, transfer.endpoint, &transfer.result);
+        client.limitTimeout(transfer.curl, *transfer.schedule);
+        curl_easy_setopt(transfer.curl, CURLOPT_PRIVATE, &transfer);
+        curl_multi_add_handle(multi, transfer.curl);
+    }
+
+    void startDueRetries() {
+        Clock::time_point now = Clock::now();
+        for (auto& transfer : transfers) {
+            if (transfer->waiting && transfer->retryAt <= now) {
+                transfer->waiting = false;
+                start(*transfer);
+            }
+        }
+    }
+
+    void drainCompleted() {
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            Transfer* transfer = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &transfer);
+
+            client.complete(transfer->curl, msg->data.result, &transfer->result);
+            client.notify(transfer->result);
+            curl_multi_remove_handle(multi, transfer->curl);
+            client.release(transfer->curl);
+            transfer->curl = nullptr;
+
+            const FetchResult& result = transfer->result;
+            std::chrono::milliseconds wait;
+            if (!result.ok() && !result.notModified() &&
+                transfer->schedule->next(result.curlCode, result.httpCode, result.retryAfter, wait)) {
+                transfer->waiting = true;
+                transfer->retryAt = Clock::now() + wait;
+                continue;
+            }
+
+            if (transfer->onComplete) {
+                transfer->onComplete(transfer->result);
+            }
+        }
+    }
+
+    InnergyClient& client;
+    CURLM* multi = nullptr;
+    std::vector<std::unique_ptr<Transfer>> transfers;
+};
+
+#endif
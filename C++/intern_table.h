@@ -0,0 +1,136 @@
+/**
+ * Intern Table
+ *
+ * One copy of every distinct value of the fields that repeat across work
+ * orders (Status, Facility, Step, CurrencyCode, people, ...) in one
+ * decoded batch, each with a 32-bit id. A decoded field is then just a
+ * pointer to its entry: 8 bytes instead of a string view, equal values
+ * have equal entries, and the columns and indexes map ids to their codes
+ * with an array lookup instead of hashing the text.
+ *
+ *   1. Every WorkOrderBatch owns its table, so the table goes away with
+ *      the batch. A long running process (--serve) that decodes a new
+ *      response on every refresh doesn't collect the values of all the
+ *      old ones
+ *   2. Entries and their texts live in the table's arena and never move,
+ *      so a field reads its text without going through the table
+ *   3. Only the decoder of the batch adds values, so the table has no
+ *      locks; a finished batch is read-only and can be shared between
+ *      threads
+ *
+ * Ids are dense, start at 0 for "" and only mean something within one
+ * batch; columns and indexes are built from the work orders of one batch.
+ *
+ * Header only, include it from work_order.h.
+ */
+
+#ifndef INTERN_TABLE_H
+#define INTERN_TABLE_H
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include "arena.h"
+
+/**
+ * InternEntry - One distinct value of an InternTable.
+ */
+struct InternEntry {
+    std::string_view text;
+    uint32_t id = 0;
+};
+
+/**
+ * EMPTY_INTERN_ENTRY - The entry of "" in every table, so a default
+ * constructed InternedString needs none.
+ */
+inline const InternEntry EMPTY_INTERN_ENTRY{};
+
+/**
+ * InternedString - A string field stored as a pointer to its InternEntry.
+ *
+ * It converts to std::string_view, so it reads like the string it stands
+ * for. Comparing two InternedStrings of the same batch compares their
+ * entries.
+ */
+class InternedString {
+public:
+    InternedString() = default;
+
+    explicit InternedString(const InternEntry* entry) : entry(entry) {}
+
+    uint32_t id() const {
+        return entry->id;
+    }
+
+    std::string_view view() const {
+        return entry->text;
+    }
+
+    operator std::string_view() const {
+        return view();
+    }
+
+    bool empty() const {
+        return entry->id == 0;
+    }
+
+    friend bool operator==(InternedString a, InternedString b) {
+        return a.entry == b.entry;
+    }
+
+    friend bool operator!=(InternedString a, InternedString b) {
+        return a.entry != b.entry;
+    }
+
+    friend bool operator==(InternedString a, std::string_view b) {
+        return a.view() == b;
+    }
+
+    friend bool operator!=(InternedString a, std::string_view b) {
+        return a.view() != b;
+    }
+
+private:
+    const InternEntry* entry = &EMPTY_INTERN_ENTRY;
+};
+
+class InternTable {
+public:
+    InternTable() = default;
+
+    // The lookups and the handed out entries point into the arena
+    InternTable(const InternTable&) = delete;
+    InternTable& operator=(const InternTable&) = delete;
+
+    /**
+     * intern - value as an InternedString, adding it if it is new. Not
+     * thread-safe.
+     */
+    InternedString intern(std::string_view value) {
+        if (value.empty()) return InternedString();
+        auto it = entries.find(value);
+        if (it != entries.end()) return InternedString(it->second);
+
+        uint32_t id = static_cast<uint32_t>(entries.size() + 1);
+        const InternEntry* entry =
+            new (storage.allocate(sizeof(InternEntry), alignof(InternEntry))) InternEntry{storage.copy(value), id};
+        entries.emplace(entry->text, entry);
+        return InternedString(entry);
+    }
+
+    /**
+     * size - The number of ids handed out, "" included; every id is below
+     * it.
+     */
+    size_t size() const {
+        return entries.size() + 1;
+    }
+
+private:
+    Arena storage;
+    std::unordered_map<std::string_view, const InternEntry*> entries;
+};
+
+#endif
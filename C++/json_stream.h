@@ -0,0 +1,573 @@
+/**
+ * Streaming JSON Parser
+ *
+ * An incremental, resumable JSON tokenizer. Instead of waiting for the
+ * whole response and parsing it afterwards, feed() is called with every
+ * chunk cURL delivers and the parser emits events (start object, key,
+ * value, end) to a JsonHandler as soon as each token is complete. A token
+ * that is cut in half by a chunk boundary is kept in a small scratch
+ * buffer, so memory stays bounded by the largest single token rather than
+ * by the size of the response.
+ *
+ * Header only, include it from work_orders.cpp.
+ */
+
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * JsonHandler - Receives parse events from JsonStreamParser.
+ *
+ * Override only the events you care about. Strings are passed already
+ * unescaped. Numbers are passed as their original text so the handler can
+ * pick the type it needs. Views are only valid during the call.
+ */
+class JsonHandler {
+public:
+    virtual ~JsonHandler() = default;
+
+    virtual void startObject() {}
+    virtual void endObject() {}
+    virtual void startArray() {}
+    virtual void endArray() {}
+    virtual void key(std::string_view) {}
+    virtual void string(std::string_view) {}
+    virtual void number(std::string_view) {}
+    virtual void boolean(bool) {}
+    virtual void null() {}
+};
+
+/**
+ * JsonStreamParser - Push parser that can be fed a document in pieces.
+ *
+ *   1. feed() walks the chunk once, byte by byte outside of strings
+ *   2. Strings without escapes that fit in the chunk are passed to the
+ *      handler as a view into the chunk, no copy is made
+ *   3. Strings with escapes, or that cross a chunk boundary, are decoded
+ *      into the scratch buffer and finished on the next feed()
+ *   4. Numbers and true/false/null are resumable the same way; numbers
+ *      are checked against the JSON grammar as they are scanned
+ *   5. finish() checks that the document was complete
+ *
+ * Malformed input throws std::runtime_error with the byte offset.
+ */
+class JsonStreamParser {
+public:
+    explicit JsonStreamParser(JsonHandler& handler) : handler(handler) {}
+
+    /**
+     * reset - Prepares the parser for a new document.
+     */
+    void reset() {
+        state = State::Value;
+        token = Token::None;
+        stack.clear();
+        scratch.clear();
+        offset = 0;
+        escape = Escape::None;
+        highSurrogate = 0;
+    }
+
+    /**
+     * feed - Parses the next chunk of the document.
+     */
+    void feed(const char* data, size_t size) {
+        size_t i = 0;
+
+        while (i < size) {
+            if (token != Token::None) {
+                i = continueToken(data, size, i);
+                continue;
+            }
+
+            char c = data[i];
+            if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+                i++;
+                continue;
+            }
+
+            switch (state) {
+                case State::Value:
+                case State::ValueOrArrayEnd:
+                    if (c == ']' && state == State::ValueOrArrayEnd) {
+                        closeContainer(i, '[');
+                        i++;
+                    } else {
+                        i = startValue(data, size, i);
+                    }
+                    break;
+
+                case State::KeyOrObjectEnd:
+                case State::Key:
+                    if (c == '}' && state == State::KeyOrObjectEnd) {
+                        closeContainer(i, '{');
+                        i++;
+                    } else if (c == '"') {
+                        i = startString(data, size, i + 1, true);
+                    } else {
+                        fail(i, "expected object key");
+                    }
+                    break;
+
+                case State::Colon:
+                    if (c != ':') fail(i, "expected ':'");
+                    state = State::Value;
+                    i++;
+                    break;
+
+                case State::CommaOrEnd:
+                    if (c == ',') {
+                        state = stack.back() == '{' ? State::Key : State::Value;
+                    } else if (c == '}' || c == ']') {
+                        closeContainer(i, c == '}' ? '{' : '[');
+                    } else {
+                        fail(i, "expected ',' or end of container");
+                    }
+                    i++;
+                    break;
+
+                case State::Done:
+                    fail(i, "unexpected data after document");
+            }
+        }
+
+        offset += size;
+    }
+
+    void feed(std::string_view chunk) {
+        feed(chunk.data(), chunk.size());
+    }
+
+    /**
+     * finish - Ends the document. Flushes a trailing top level number and
+     * throws if the document is incomplete.
+     */
+    void finish() {
+        if (token == Token::Number) {
+            if (!numberComplete()) fail(0, "invalid number");
+            handler.number(scratch);
+            scratch.clear();
+            token = Token::None;
+            valueDone();
+        }
+        if (token != Token::None || state != State::Done) {
+            throw std::runtime_error("JSON parse error: unexpected end of document");
+        }
+    }
+
+    /**
+     * depth - Number of containers currently open.
+     */
+    size_t depth() const {
+        return stack.size();
+    }
+
+private:
+    enum class State {
+        Value,
+        ValueOrArrayEnd,
+        KeyOrObjectEnd,
+        Key,
+        Colon,
+        CommaOrEnd,
+        Done
+    };
+
+    enum class Token {
+        None,
+        String,
+        Number,
+        Literal
+    };
+
+    [[noreturn]] void fail(size_t i, const char* what) {
+        throw std::runtime_error("JSON parse error at byte " + std::to_string(offset + i) + ": " + what);
+    }
+
+    enum class NumberPart {
+        Start,
+        Sign,
+        Zero,
+        Integer,
+        Point,
+        Fraction,
+        Exponent,
+        ExponentSign,
+        ExponentDigits
+    };
+
+    static bool isNumberChar(char c) {
+        return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+    }
+
+    /**
+     * numberAccepts - Moves numberPart past c if c can come next in a JSON
+     * number (-?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?). False if
+     * it can't, which ends the number.
+     */
+    bool numberAccepts(char c) {
+        bool digit = c >= '0' && c <= '9';
+        bool exponent = c == 'e' || c == 'E';
+        switch (numberPart) {
+            case NumberPart::Start:
+                if (c == '-') {
+                    numberPart = NumberPart::Sign;
+                    return true;
+                }
+                [[fallthrough]];
+            case NumberPart::Sign:
+                if (!digit) return false;
+                numberPart = c == '0' ? NumberPart::Zero : NumberPart::Integer;
+                return true;
+            case NumberPart::Zero:
+            case NumberPart::Integer:
+                if (digit && numberPart == NumberPart::Integer) return true;
+                if (c == '.') numberPart = NumberPart::Point;
+                else if (exponent) numberPart = NumberPart::Exponent;
+                else return false;
+                return true;
+            case NumberPart::Point:
+            case NumberPart::Fraction:
+                if (digit) numberPart = NumberPart::Fraction;
+                else if (exponent && numberPart == NumberPart::Fraction) numberPart = NumberPart::Exponent;
+                else return false;
+                return true;
+            case NumberPart::Exponent:
+                if (c == '+' || c == '-') {
+                    numberPart = NumberPart::ExponentSign;
+                    return true;
+                }
+                [[fallthrough]];
+            case NumberPart::ExponentSign:
+            case NumberPart::ExponentDigits:
+                if (!digit) return false;
+                numberPart = NumberPart::ExponentDigits;
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * numberComplete - Whether the number scanned so far can end here.
+     */
+    bool numberComplete() const {
+        return numberPart == NumberPart::Zero || numberPart == NumberPart::Integer ||
+               numberPart == NumberPart::Fraction || numberPart == NumberPart::ExponentDigits;
+    }
+
+    /**
+     * endNumber - Checks the number that data[i] ends. A character that
+     * belongs in numbers but not at this point ("01", "1-2", "1.e5") is
+     * reported here rather than as a missing comma.
+     */
+    void endNumber(const char* data, size_t i) {
+        if (!numberComplete() || isNumberChar(data[i])) fail(i, "invalid number");
+    }
+
+    void valueDone() {
+        state = stack.empty() ? State::Done : State::CommaOrEnd;
+    }
+
+    void closeContainer(size_t i, char open) {
+        if (stack.empty() || stack.back() != open) {
+            fail(i, "mismatched bracket");
+        }
+        stack.pop_back();
+        if (open == '{') {
+            handler.endObject();
+        } else {
+            handler.endArray();
+        }
+        valueDone();
+    }
+
+    size_t startValue(const char* data, size_t size, size_t i) {
+        char c = data[i];
+        switch (c) {
+            case '{':
+                stack.push_back('{');
+                handler.startObject();
+                state = State::KeyOrObjectEnd;
+                return i + 1;
+            case '[':
+                stack.push_back('[');
+                handler.startArray();
+                state = State::ValueOrArrayEnd;
+                return i + 1;
+            case '"':
+                return startString(data, size, i + 1, false);
+            case 't':
+                literal = "true";
+                break;
+            case 'f':
+                literal = "false";
+                break;
+            case 'n':
+                literal = "null";
+                break;
+            default:
+                if (c == '-' || (c >= '0' && c <= '9')) {
+                    return startNumber(data, size, i);
+                }
+                fail(i, "unexpected character");
+        }
+
+        token = Token::Literal;
+        literalPos = 0;
+        return continueToken(data, size, i);
+    }
+
+    /**
+     * startString - Fast path for a string that starts at data[i].
+     *
+     * Scans for the closing quote. If it is found before any backslash the
+     * handler gets a view straight into the chunk. Otherwise the scanned
+     * part is copied to scratch and decoding continues in continueToken().
+     */
+    size_t startString(const char* data, size_t size, size_t i, bool isKey) {
+        stringIsKey = isKey;
+        size_t start = i;
+
+        while (i < size) {
+            unsigned char c = static_cast<unsigned char>(data[i]);
+            if (c == '"') {
+                emitString(std::string_view(data + start, i - start));
+                return i + 1;
+            }
+            if (c == '\\') break;
+            if (c < 0x20) fail(i, "control character in string");
+            i++;
+        }
+
+        scratch.assign(data + start, i - start);
+        token = Token::String;
+        escape = Escape::None;
+        return i;
+    }
+
+    size_t startNumber(const char* data, size_t size, size_t i) {
+        size_t start = i;
+        numberPart = NumberPart::Start;
+        while (i < size && numberAccepts(data[i])) i++;
+
+        if (i < size) {
+            endNumber(data, i);
+            handler.number(std::string_view(data + start, i - start));
+            valueDone();
+            return i;
+        }
+
+        scratch.assign(data + start, i - start);
+        token = Token::Number;
+        return i;
+    }
+
+    void emitString(std::string_view value) {
+        if (stringIsKey) {
+            handler.key(value);
+            state = State::Colon;
+        } else {
+            handler.string(value);
+            valueDone();
+        }
+    }
+
+    /**
+     * continueToken - Resumes a token that was cut by a chunk boundary or
+     * that needs escape decoding.
+     */
+    size_t continueToken(const char* data, size_t size, size_t i) {
+        switch (token) {
+            case Token::String:
+                return continueString(data, size, i);
+
+            case Token::Number:
+                while (i < size && numberAccepts(data[i])) {
+                    scratch += data[i++];
+                }
+                if (i < size) {
+                    endNumber(data, i);
+                    handler.number(scratch);
+                    scratch.clear();
+                    token = Token::None;
+                    valueDone();
+                }
+                return i;
+
+            case Token::Literal:
+                while (i < size && literal[literalPos] != '\0') {
+                    if (data[i] != literal[literalPos]) fail(i, "invalid literal");
+                    i++;
+                    literalPos++;
+                }
+                if (literal[literalPos] == '\0') {
+                    token = Token::None;
+                    if (literal[0] == 'n') {
+                        handler.null();
+                    } else {
+                        handler.boolean(literal[0] == 't');
+                    }
+                    valueDone();
+                }
+                return i;
+
+            case Token::None:
+                break;
+        }
+        return i;
+    }
+
+    size_t continueString(const char* data, size_t size, size_t i) {
+        while (i < size) {
+            unsigned char c = static_cast<unsigned char>(data[i]);
+
+            if (escape == Escape::None) {
+                size_t start = i;
+                while (i < size && data[i] != '"' && data[i] != '\\') {
+                    if (static_cast<unsigned char>(data[i]) < 0x20) fail(i, "control character in string");
+                    i++;
+                }
+                if (highSurrogate && i > start) {
+                    // A high surrogate followed by plain text has no pair
+                    appendUtf8(0xFFFD);
+                    highSurrogate = 0;
+                }
+                scratch.append(data + start, i - start);
+                if (i == size) break;
+
+                if (data[i] == '"') {
+                    if (highSurrogate) appendUtf8(0xFFFD);
+                    highSurrogate = 0;
+                    token = Token::None;
+                    emitString(scratch);
+                    scratch.clear();
+                    return i + 1;
+                }
+
+                escape = Escape::Backslash;
+                i++;
+                continue;
+            }
+
+            if (escape == Escape::Backslash) {
+                if (c == 'u') {
+                    escape = Escape::Unicode;
+                    unicodeDigits = 0;
+                    unicodeValue = 0;
+                    i++;
+                    continue;
+                }
+                if (highSurrogate) {
+                    appendUtf8(0xFFFD);
+                    highSurrogate = 0;
+                }
+                switch (c) {
+                    case '"': scratch += '"'; break;
+                    case '\\': scratch += '\\'; break;
+                    case '/': scratch += '/'; break;
+                    case 'b': scratch += '\b'; break;
+                    case 'f': scratch += '\f'; break;
+                    case 'n': scratch += '\n'; break;
+                    case 'r': scratch += '\r'; break;
+                    case 't': scratch += '\t'; break;
+                    default: fail(i, "invalid escape");
+                }
+                escape = Escape::None;
+                i++;
+                continue;
+            }
+
+            // Escape::Unicode, collecting the 4 hex digits of \uXXXX
+            unsigned digit;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+            else fail(i, "invalid \\u escape");
+
+            unicodeValue = (unicodeValue << 4) | digit;
+            i++;
+            if (++unicodeDigits < 4) continue;
+
+            escape = Escape::None;
+            appendCodeUnit(unicodeValue);
+        }
+
+        return i;
+    }
+
+    /**
+     * appendCodeUnit - Adds one UTF-16 code unit from a \u escape, joining
+     * surrogate pairs into a single code point.
+     */
+    void appendCodeUnit(uint32_t unit) {
+        if (unit >= 0xD800 && unit <= 0xDBFF) {
+            if (highSurrogate) appendUtf8(0xFFFD);
+            highSurrogate = unit;
+            return;
+        }
+        if (unit >= 0xDC00 && unit <= 0xDFFF) {
+            if (highSurrogate) {
+                appendUtf8(0x10000 + ((highSurrogate - 0xD800) << 10) + (unit - 0xDC00));
+                highSurrogate = 0;
+            } else {
+                appendUtf8(0xFFFD);
+            }
+            return;
+        }
+        if (highSurrogate) {
+            appendUtf8(0xFFFD);
+            highSurrogate = 0;
+        }
+        appendUtf8(unit);
+    }
+
+    void appendUtf8(uint32_t cp) {
+        if (cp < 0x80) {
+            scratch += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            scratch += static_cast<char>(0xC0 | (cp >> 6));
+            scratch += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            scratch += static_cast<char>(0xE0 | (cp >> 12));
+            scratch += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            scratch += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            scratch += static_cast<char>(0xF0 | (cp >> 18));
+            scratch += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            scratch += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            scratch += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    enum class Escape {
+        None,
+        Backslash,
+        Unicode
+    };
+
+    JsonHandler& handler;
+    State state = State::Value;
+    Token token = Token::None;
+    std::vector<char> stack;
+    std::string scratch;
+    size_t offset = 0;
+
+    bool stringIsKey = false;
+    Escape escape = Escape::None;
+    unsigned unicodeDigits = 0;
+    uint32_t unicodeValue = 0;
+    uint32_t highSurrogate = 0;
+
+    NumberPart numberPart = NumberPart::Start;
+
+    const char* literal = "";
+    size_t literalPos = 0;
+};
+
+#endif
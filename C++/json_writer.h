@@ -0,0 +1,582 @@
+/**
+ * JSON Writer
+ *
+ * Helpers for writing JSON text without an external JSON library.
+ *
+ * Header only, include it from work_orders.cpp.
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json_writer_detail {
+
+/**
+ * needsEscape - True for the bytes JSON strings can't contain as is.
+ */
+inline bool needsEscape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+/**
+ * ScanFunction - Returns the offset of the first byte in data that needs
+ * escaping, or size if there is none.
+ */
+using ScanFunction = size_t (*)(const char* data, size_t size);
+
+inline size_t scanScalar(const char* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (needsEscape(static_cast<unsigned char>(data[i]))) return i;
+    }
+    return size;
+}
+
+#ifdef JSON_INDEX_X86
+__attribute__((target("sse2")))
+inline size_t scanSse2(const char* data, size_t size) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        // min(v, 0x1F) == v only for bytes 0x00..0x1F (unsigned)
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                    _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + scanScalar(data + i, size - i);
+}
+
+__attribute__((target("avx2")))
+inline size_t scanAvx2(const char* data, size_t size) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                                       _mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + scanSse2(data + i, size - i);
+}
+#endif
+
+/**
+ * selectScanFunction - Picks the fastest scan this CPU runs.
+ */
+inline ScanFunction selectScanFunction() {
+#ifdef JSON_INDEX_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return scanAvx2;
+    }
+    return scanSse2;
+#else
+    return scanScalar;
+#endif
+}
+
+}
+
+/**
+ * ItemCounter - Counts the records of a response while it is tokenized.
+ *
+ * A record is a top-level element of the Items array of the root object,
+ * or of the root array when the response is a bare list. Nested ids,
+ * Assignees and strings that happen to contain "Id": are not counted.
+ * The printers call it once per token, so counting costs no extra pass.
+ */
+class ItemCounter {
+public:
+    void open(char c) {
+        value();
+        depth++;
+        if (c == '[' && (depth == 1 || (depth == 2 && itemsKey))) {
+            itemsDepth = depth;
+            awaitingFirst = true;
+        }
+    }
+
+    void close() {
+        if (depth == itemsDepth) {
+            itemsDepth = -1;
+            awaitingFirst = false;
+        }
+        if (depth > 0) depth--;
+    }
+
+    void comma() {
+        if (depth == itemsDepth) count++;
+    }
+
+    /**
+     * key - A key of the current object; only keys of the root object
+     * matter.
+     */
+    void key(std::string_view name) {
+        if (depth == 1) itemsKey = name == "Items";
+    }
+
+    /**
+     * value - Start of a string, number or literal value.
+     */
+    void value() {
+        if (awaitingFirst && depth == itemsDepth) {
+            count++;
+            awaitingFirst = false;
+        }
+    }
+
+    size_t count = 0;
+
+private:
+    int depth = 0;
+    int itemsDepth = -1;
+    bool itemsKey = false;
+    bool awaitingFirst = false;
+};
+
+/**
+ * JsonWriter - Helper class for JSON string operations.
+ *
+ * This class provides static methods for working with JSON strings.
+ * Since we're not using an external JSON library, we need to handle
+ * escaping special characters and formatting manually.
+ */
+class JsonWriter {
+public:
+    /**
+     * escape - Escapes special characters in a string for JSON output.
+     * really meant for readability.
+     */
+    static std::string escape(std::string_view s) {
+        std::string result;
+        result.reserve(s.size() + 16);
+        escapeTo(result, s);
+        return result;
+    }
+
+    /**
+     * escapeTo - Appends the escaped form of s to out.
+     *
+     *   1. Finds the next byte that needs escaping with a SIMD scan
+     *      (quote, backslash or any control character below 0x20)
+     *   2. Copies the clean run before it in one append
+     *   3. Writes the escape: the short form for \" \\ \b \f \n \r \t,
+     *      \u00XX for every other control character
+     *   4. Repeats from the byte after it
+     *
+     * Most strings need no escaping at all and become a single append.
+     */
+    static void escapeTo(std::string& out, std::string_view s) {
+        static const json_writer_detail::ScanFunction scan = json_writer_detail::selectScanFunction();
+        static const char hex[] = "0123456789abcdef";
+
+        const char* data = s.data();
+        size_t size = s.size();
+        size_t i = 0;
+
+        while (i < size) {
+            size_t j = i + scan(data + i, size - i);
+            out.append(data + i, j - i);
+            if (j == size) break;
+
+            unsigned char c = static_cast<unsigned char>(data[j]);
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default: {
+                    char u[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                    out.append(u, sizeof(u));
+                }
+            }
+            i = j + 1;
+        }
+    }
+
+    /**
+     * prettyPrint - Formats a JSON string with indentation and newlines.
+     *
+     *   1. Reserves the output up front from an estimate of its size
+     *   2. Walks the JSON string once
+     *   3. When encountering a quote: finds the end of the string, skipping
+     *      over escaped characters, and copies the whole string in one append
+     *   4. When encountering { or [: adds newline and increases indent
+     *   5. When encountering } or ]: decreases indent and adds newline before
+     *   6. When encountering comma: adds newline and current indentation
+     *   7. When encountering colon: adds a space after for readability
+     *   8. Skips whitespace outside of strings, we add our own formatting
+     *   9. Indentation is copied from a static buffer of spaces
+     *   10. If itemCount is given, the records of the response are counted
+     *       with an ItemCounter on the way; a string is a key when a colon
+     *       follows it
+     *   11. Returns the formatted JSON string
+     */
+    static std::string prettyPrint(std::string_view json, size_t* itemCount = nullptr) {
+        std::string result;
+        result.reserve(estimatePrettySize(json.size()));
+
+        const char* data = json.data();
+        size_t size = json.size();
+        int indent = 0;
+        ItemCounter counter;
+        std::string_view lastString;
+
+        for (size_t i = 0; i < size; i++) {
+            char c = data[i];
+
+            switch (c) {
+                case '"': {
+                    size_t end = stringEnd(json, i);
+                    result.append(data + i, end - i);
+                    counter.value();
+                    lastString = json.substr(i + 1, end - i - 2);
+                    i = end - 1;
+                    break;
+                }
+                case '{':
+                case '[':
+                    counter.open(c);
+                    result += c;
+                    result += '\n';
+                    indent++;
+                    appendIndent(result, indent);
+                    break;
+                case '}':
+                case ']':
+                    counter.close();
+                    result += '\n';
+                    if (indent > 0) indent--;
+                    appendIndent(result, indent);
+                    result += c;
+                    break;
+                case ',':
+                    counter.comma();
+                    result += c;
+                    result += '\n';
+                    appendIndent(result, indent);
+                    break;
+                case ':':
+                    counter.key(lastString);
+                    result += c;
+                    result += ' ';
+                    break;
+                case ' ':
+                case '\n':
+                case '\r':
+                case '\t':
+                    break;
+                default:
+                    counter.value();
+                    result += c;
+            }
+        }
+
+        if (itemCount) *itemCount = counter.count;
+        return result;
+    }
+
+    /**
+     * estimatePrettySize - Output size estimate used to reserve once.
+     *
+     * Work order payloads have short keys and values a few levels deep, so
+     * the formatted text comes out at roughly 1.6 to 1.8 times the input.
+     */
+    static size_t estimatePrettySize(size_t inputSize) {
+        return inputSize + inputSize * 3 / 4 + 64;
+    }
+
+    /**
+     * appendIndent - Appends indent levels of two spaces from a static
+     * buffer, without building a temporary string.
+     */
+    static void appendIndent(std::string& out, int indent) {
+        static const char spaces[] =
+            "                                                                "
+            "                                                                ";
+        size_t count = static_cast<size_t>(indent) * 2;
+        while (count > 0) {
+            size_t n = count < sizeof(spaces) - 1 ? count : sizeof(spaces) - 1;
+            out.append(spaces, n);
+            count -= n;
+        }
+    }
+
+    /**
+     * stringEnd - Returns the offset just past the closing quote of the
+     * string whose opening quote is at json[start].
+     *
+     *   1. Jumps to the next quote with memchr, which scans many bytes per
+     *      instruction
+     *   2. Counts the backslashes right before it: an odd number means the
+     *      quote is escaped (\"), an even number means it is real (\\")
+     *   3. An unterminated string runs to the end of the input
+     */
+    static size_t stringEnd(std::string_view json, size_t start) {
+        const char* begin = json.data() + start + 1;
+        const char* end = json.data() + json.size();
+        const char* p = begin;
+
+        while (p < end) {
+            const char* quote = static_cast<const char*>(std::memchr(p, '"', end - p));
+            if (!quote) break;
+
+            size_t backslashes = 0;
+            while (quote - backslashes > begin && quote[-1 - static_cast<ptrdiff_t>(backslashes)] == '\\') {
+                backslashes++;
+            }
+            if (backslashes % 2 == 0) {
+                return quote - json.data() + 1;
+            }
+            p = quote + 1;
+        }
+        return json.size();
+    }
+};
+
+/**
+ * JsonStreamFormatter - Pretty printer that is fed the document in chunks.
+ *
+ *   1. feed() formats one chunk and appends the result to out, so the
+ *      caller can write it out right away and clear the buffer
+ *   2. Whether we are inside a string, a pending backslash or \uXXXX
+ *      escape and the indent level carry over from one chunk to the next
+ *   3. String contents are copied in runs, not byte by byte
+ *   4. The output is the same as JsonWriter::prettyPrint on the whole text
+ *   5. close() finishes a document that was cut off (for example by a
+ *      failed transfer) so the output is still valid JSON, and says
+ *      whether it was
+ *   6. The records of the response are counted on the way, see
+ *      itemCount()
+ *
+ * Memory use is O(chunk) instead of holding the input and a formatted copy.
+ */
+class JsonStreamFormatter {
+public:
+    void feed(const char* data, size_t size, std::string& out) {
+        size_t i = 0;
+
+        while (i < size) {
+            if (inString) {
+                size_t start = i;
+                bool ended = false;
+                while (i < size) {
+                    char c = data[i++];
+                    if (escaped) {
+                        escaped = false;
+                        if (c == 'u') unicodeDigits = 4;
+                    } else if (c == '\\') {
+                        escaped = true;
+                    } else if (c == '"') {
+                        unicodeDigits = 0;
+                        ended = true;
+                        break;
+                    } else if (unicodeDigits > 0) {
+                        unicodeDigits--;
+                    }
+                }
+                out.append(data + start, i - start);
+                if (collectKey && key.size() < 8) {
+                    key.append(data + start, std::min(i - start - ended, 8 - key.size()));
+                }
+                if (ended) {
+                    inString = false;
+                    afterString();
+                }
+                continue;
+            }
+
+            char c = data[i++];
+            switch (c) {
+                case '"':
+                    inString = true;
+                    scalar.clear();
+                    collectKey = expect == Expect::Key || expect == Expect::FirstKey;
+                    key.clear();
+                    if (!collectKey) counter.value();
+                    out += c;
+                    break;
+                case '{':
+                case '[':
+                    counter.open(c);
+                    stack.push_back(c);
+                    expect = c == '{' ? Expect::FirstKey : Expect::FirstValue;
+                    out += c;
+                    out += '\n';
+                    JsonWriter::appendIndent(out, static_cast<int>(stack.size()));
+                    break;
+                case '}':
+                case ']':
+                    counter.close();
+                    if (!stack.empty()) stack.pop_back();
+                    expect = Expect::Comma;
+                    scalar.clear();
+                    out += '\n';
+                    JsonWriter::appendIndent(out, static_cast<int>(stack.size()));
+                    out += c;
+                    break;
+                case ',':
+                    counter.comma();
+                    expect = !stack.empty() && stack.back() == '{' ? Expect::Key : Expect::Value;
+                    scalar.clear();
+                    out += c;
+                    out += '\n';
+                    JsonWriter::appendIndent(out, static_cast<int>(stack.size()));
+                    break;
+                case ':':
+                    expect = Expect::Value;
+                    out += c;
+                    out += ' ';
+                    break;
+                case ' ':
+                case '\n':
+                case '\r':
+                case '\t':
+                    break;
+                default:
+                    if (scalar.empty()) counter.value();
+                    if (scalar.size() < 8) scalar += c;
+                    scalarLast = c;
+                    expect = Expect::Comma;
+                    out += c;
+            }
+        }
+    }
+
+    void feed(std::string_view chunk, std::string& out) {
+        feed(chunk.data(), chunk.size(), out);
+    }
+
+    /**
+     * close - Completes a truncated document: finishes an open escape,
+     * ends an open string or literal, fills in a missing value, and closes
+     * every open container.
+     *
+     * Returns false if the document was truncated, i.e. anything had to be
+     * added; the output is valid JSON either way, but it is not the
+     * response the server meant to send.
+     */
+    bool close(std::string& out) {
+        size_t before = out.size();
+        if (inString) {
+            if (escaped) out += '\\';
+            out.append(unicodeDigits, '0');
+            out += '"';
+            inString = false;
+            escaped = false;
+            unicodeDigits = 0;
+            afterString();
+        }
+
+        completeScalar(out);
+
+        if (expect == Expect::Colon) {
+            out += ": null";
+        } else if (expect == Expect::Value) {
+            out += "null";
+        } else if (expect == Expect::Key) {
+            out += "\"\": null";
+        }
+
+        while (!stack.empty()) {
+            char open = stack.back();
+            stack.pop_back();
+            out += '\n';
+            JsonWriter::appendIndent(out, static_cast<int>(stack.size()));
+            out += open == '{' ? '}' : ']';
+        }
+        expect = Expect::Comma;
+        return out.size() == before;
+    }
+
+    /**
+     * depth - Number of containers currently open.
+     */
+    size_t depth() const {
+        return stack.size();
+    }
+
+    /**
+     * itemCount - Records seen so far, counted like ItemCounter does.
+     */
+    size_t itemCount() const {
+        return counter.count;
+    }
+
+private:
+    enum class Expect {
+        FirstKey,
+        FirstValue,
+        Key,
+        Value,
+        Colon,
+        Comma
+    };
+
+    void afterString() {
+        if (collectKey) {
+            counter.key(key);
+            collectKey = false;
+        }
+        expect = (expect == Expect::Key || expect == Expect::FirstKey) ? Expect::Colon : Expect::Comma;
+    }
+
+    /**
+     * completeScalar - Finishes a number or literal that was cut off, e.g.
+     * "tr" becomes "true" and "12." becomes "12.0".
+     */
+    void completeScalar(std::string& out) {
+        if (scalar.empty()) return;
+
+        static const char* literals[] = {"true", "false", "null"};
+        for (const char* literal : literals) {
+            std::string_view word(literal);
+            if (word.size() > scalar.size() && word.compare(0, scalar.size(), scalar) == 0) {
+                out.append(word.substr(scalar.size()));
+                break;
+            }
+        }
+
+        char first = scalar.front();
+        char last = scalarLast;
+        bool isNumber = first == '-' || (first >= '0' && first <= '9');
+        if (isNumber && (last == '-' || last == '+' || last == '.' || last == 'e' || last == 'E')) {
+            out += '0';
+        }
+        scalar.clear();
+    }
+
+    std::vector<char> stack;
+    bool inString = false;
+    bool escaped = false;
+    unsigned unicodeDigits = 0;
+    Expect expect = Expect::Value;
+    // The first characters of a number or literal, enough to match the
+    // literals, and its real last character for completeScalar
+    std::string scalar;
+    char scalarLast = '\0';
+    ItemCounter counter;
+    bool collectKey = false;
+    std::string key;
+};
+
+#endif
@@ -0,0 +1,345 @@
+/**
+ * Metrics
+ *
+ * A small metrics registry in the Prometheus text exposition format, so
+ * scheduled runs can be graphed and alerted on instead of only printing
+ * success: true or false.
+ *
+ *   - Counter: a number that only goes up (requests, bytes)
+ *   - Gauge: a number that is set (records in the last response)
+ *   - GaugeFunction: a gauge read from a function whenever the metrics
+ *     are rendered (the current rate limiter queue)
+ *   - Histogram: observations counted into fixed buckets (latencies)
+ *
+ * Updating a metric is a few relaxed atomic operations and never takes a
+ * lock, so it is safe from any thread, including cURL callbacks. Only
+ * registering a new series and rendering take the registry mutex.
+ *
+ * Header only, include it from work_orders.cpp.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+/**
+ * MetricLabels - Label names and values of one series, e.g.
+ * {{"endpoint", "projectWorkOrders"}}.
+ */
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+namespace metrics_detail {
+
+/**
+ * formatValue - Formats a sample value the way Prometheus expects,
+ * including +Inf for the last histogram bucket. Uses the fewest digits
+ * that read back as the same double, so a bound of 0.005 is "0.005" and
+ * not "0.0050000000000000001".
+ */
+inline std::string formatValue(double value) {
+    if (value == std::numeric_limits<double>::infinity()) return "+Inf";
+    char buffer[32];
+    for (int precision = 15; precision <= 17; precision++) {
+        std::snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+        if (std::strtod(buffer, nullptr) == value) break;
+    }
+    return buffer;
+}
+
+/**
+ * formatLabels - Renders labels as {name="value",...}, escaping
+ * backslashes, quotes and newlines in the values.
+ */
+inline std::string formatLabels(const MetricLabels& labels) {
+    if (labels.empty()) return "";
+
+    std::string out = "{";
+    for (size_t i = 0; i < labels.size(); i++) {
+        if (i > 0) out += ',';
+        out += labels[i].first;
+        out += "=\"";
+        for (char c : labels[i].second) {
+            if (c == '\\') out += "\\\\";
+            else if (c == '"') out += "\\\"";
+            else if (c == '\n') out += "\\n";
+            else out += c;
+        }
+        out += '"';
+    }
+    out += '}';
+    return out;
+}
+
+/**
+ * addLabel - labels with one more label appended, used for "le".
+ */
+inline MetricLabels addLabel(MetricLabels labels, const char* name, const std::string& value) {
+    labels.emplace_back(name, value);
+    return labels;
+}
+
+/**
+ * atomicAdd - fetch_add for std::atomic<double>, which C++17 lacks.
+ */
+inline void atomicAdd(std::atomic<double>& target, double value) {
+    double current = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {
+    }
+}
+
+}
+
+/**
+ * Metric - Base class of one series; knows how to render itself.
+ */
+class Metric {
+public:
+    virtual ~Metric() = default;
+    virtual void render(std::string& out, const std::string& name, const MetricLabels& labels) const = 0;
+};
+
+class Counter : public Metric {
+public:
+    void inc(uint64_t n = 1) {
+        value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t get() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    void render(std::string& out, const std::string& name, const MetricLabels& labels) const override {
+        out += name + metrics_detail::formatLabels(labels) + " " + std::to_string(get()) + "\n";
+    }
+
+private:
+    std::atomic<uint64_t> value{0};
+};
+
+class Gauge : public Metric {
+public:
+    void set(double v) {
+        value.store(v, std::memory_order_relaxed);
+    }
+
+    double get() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    void render(std::string& out, const std::string& name, const MetricLabels& labels) const override {
+        out += name + metrics_detail::formatLabels(labels) + " " + metrics_detail::formatValue(get()) + "\n";
+    }
+
+private:
+    std::atomic<double> value{0};
+};
+
+/**
+ * GaugeFunction - A gauge whose value is read when it is rendered, for
+ * state that is cheap to read but changes without any event to set it.
+ * read is called under the registry mutex, so it must not use the
+ * registry itself.
+ */
+class GaugeFunction : public Metric {
+public:
+    explicit GaugeFunction(std::function<double()> read) : read(std::move(read)) {}
+
+    void render(std::string& out, const std::string& name, const MetricLabels& labels) const override {
+        out += name + metrics_detail::formatLabels(labels) + " " + metrics_detail::formatValue(read()) + "\n";
+    }
+
+private:
+    std::function<double()> read;
+};
+
+/**
+ * Histogram - Counts observations into buckets with fixed upper bounds.
+ *
+ *   1. observe() finds the first bound >= value (a short linear scan, the
+ *      bucket lists are small) and bumps that one bucket
+ *   2. render() turns the per-bucket counts into the cumulative le="..."
+ *      series Prometheus expects, plus _sum and _count
+ */
+class Histogram : public Metric {
+public:
+    explicit Histogram(std::vector<double> upperBounds)
+        : bounds(std::move(upperBounds)), buckets(new std::atomic<uint64_t>[bounds.size() + 1]) {
+        for (size_t i = 0; i <= bounds.size(); i++) {
+            buckets[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void observe(double value) {
+        size_t i = 0;
+        while (i < bounds.size() && value > bounds[i]) i++;
+        buckets[i].fetch_add(1, std::memory_order_relaxed);
+        metrics_detail::atomicAdd(sum, value);
+    }
+
+    void render(std::string& out, const std::string& name, const MetricLabels& labels) const override {
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i <= bounds.size(); i++) {
+            cumulative += buckets[i].load(std::memory_order_relaxed);
+            double bound = i < bounds.size() ? bounds[i] : std::numeric_limits<double>::infinity();
+            out += name + "_bucket" +
+                   metrics_detail::formatLabels(metrics_detail::addLabel(labels, "le", metrics_detail::formatValue(bound))) +
+                   " " + std::to_string(cumulative) + "\n";
+        }
+        std::string labelText = metrics_detail::formatLabels(labels);
+        out += name + "_sum" + labelText + " " + metrics_detail::formatValue(sum.load(std::memory_order_relaxed)) + "\n";
+        out += name + "_count" + labelText + " " + std::to_string(cumulative) + "\n";
+    }
+
+    /**
+     * latencyBuckets - Bounds in seconds from 5 ms to 60 s, for requests.
+     */
+    static std::vector<double> latencyBuckets() {
+        return {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60};
+    }
+
+    /**
+     * processingBuckets - Bounds in seconds from 100 us to 5 s, for local
+     * work such as parsing, which is much faster than a request.
+     */
+    static std::vector<double> processingBuckets() {
+        return {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 5};
+    }
+
+private:
+    std::vector<double> bounds;
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+    std::atomic<double> sum{0};
+};
+
+/**
+ * MetricsRegistry - Owns every series and renders them.
+ *
+ * counter(), gauge() and histogram() return the series for a name and a
+ * set of labels, creating it the first time; gaugeFunction() registers
+ * read for the series the first time and keeps the first one. The
+ * reference stays valid for the life of the registry, so callers look a
+ * series up once and then update it without touching the registry again.
+ * A name belongs to one kind of series: asking for it as another kind,
+ * even one with the same Prometheus type such as gauge() and
+ * gaugeFunction(), throws.
+ */
+class MetricsRegistry {
+public:
+    Counter& counter(const std::string& name, const std::string& help, const MetricLabels& labels = {}) {
+        return series<Counter>(name, help, "counter", labels, [] { return std::make_unique<Counter>(); });
+    }
+
+    Gauge& gauge(const std::string& name, const std::string& help, const MetricLabels& labels = {}) {
+        return series<Gauge>(name, help, "gauge", labels, [] { return std::make_unique<Gauge>(); });
+    }
+
+    GaugeFunction& gaugeFunction(const std::string& name, const std::string& help, const MetricLabels& labels,
+                                 std::function<double()> read) {
+        return series<GaugeFunction>(name, help, "gauge", labels,
+                                     [&] { return std::make_unique<GaugeFunction>(std::move(read)); });
+    }
+
+    Histogram& histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds,
+                         const MetricLabels& labels = {}) {
+        return series<Histogram>(name, help, "histogram", labels, [&] { return std::make_unique<Histogram>(bounds); });
+    }
+
+    /**
+     * render - All metrics in the Prometheus text format (version 0.0.4),
+     * one HELP and TYPE line per metric name followed by its series.
+     */
+    std::string render() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::string out;
+        for (const auto& entry : families) {
+            const Family& family = entry.second;
+            out += "# HELP " + entry.first + " " + family.help + "\n";
+            out += "# TYPE " + entry.first + " " + family.type + "\n";
+            for (const auto& item : family.series) {
+                item.second.metric->render(out, entry.first, item.second.labels);
+            }
+        }
+        return out;
+    }
+
+    /**
+     * writeFile - Writes render() to path through a temporary file and a
+     * rename, so a collector reading the file (e.g. the node_exporter
+     * textfile collector) never sees it half written.
+     */
+    void writeFile(const std::string& path) const {
+        std::string tmpPath = path + ".tmp." + std::to_string(getpid());
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!file) {
+                throw std::runtime_error("Failed to open metrics file: " + tmpPath);
+            }
+            file << render();
+            if (!file.flush()) {
+                std::remove(tmpPath.c_str());
+                throw std::runtime_error("Failed to write metrics file: " + tmpPath);
+            }
+        }
+        if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+            std::remove(tmpPath.c_str());
+            throw std::runtime_error("Failed to replace metrics file: " + path);
+        }
+    }
+
+private:
+    struct Series {
+        MetricLabels labels;
+        std::unique_ptr<Metric> metric;
+    };
+
+    struct Family {
+        std::string help;
+        std::string type;
+        std::type_index kind = typeid(void);
+        std::map<std::string, Series> series;
+    };
+
+    template <typename T, typename Make>
+    T& series(const std::string& name, const std::string& help, const char* type, const MetricLabels& labels,
+              Make make) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Family& family = families[name];
+        if (family.type.empty()) {
+            family.help = help;
+            family.type = type;
+            family.kind = typeid(T);
+        } else if (family.kind != typeid(T)) {
+            throw std::runtime_error("Metric " + name + " registered as two kinds of series");
+        }
+
+        Series& entry = family.series[metrics_detail::formatLabels(labels)];
+        if (!entry.metric) {
+            entry.labels = labels;
+            entry.metric = make();
+        }
+        return static_cast<T&>(*entry.metric);
+    }
+
+    mutable std::mutex mutex;
+    std::map<std::string, Family> families;
+};
+
+#endif
@@ -0,0 +1,396 @@
+/**
+ * Mock Innergy API Server
+ *
+ * Serves synthetic API responses on 127.0.0.1, so fetching, retries and
+ * concurrency can be measured without app.innergy.com, an API key or a
+ * network. Point the client at it with --base-url.
+ *
+ * Dependencies: zlib
+ *
+ * Install on Ubuntu/Debian:
+ *   sudo apt-get install g++ zlib1g-dev
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 -o mock_server mock_server.cpp -lz -pthread
+ *
+ * Run:
+ *   ./mock_server --port=8080 --items=100000
+ *   ./mock_server --latency-ms=50 --jitter-ms=20 --chunk-size=16384 --chunk-delay-ms=5
+ *   ./mock_server --throttle-rate=0.1 --unavailable-rate=0.05 --error-rate=0.01 --retry-after=2
+ *   ./mock_server --gzip --api-key=test
+ *
+ *   ./work_orders --base-url=http://127.0.0.1:8080/api/
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <zlib.h>
+
+#include "http_server.h"
+#include "payload_generator.h"
+
+/**
+ * MockOptions - Command line settings of the mock server.
+ *
+ * The rates are fractions of requests between 0 and 1. They are drawn in
+ * the order throttle, unavailable, error, corrupt, so they add up.
+ */
+struct MockOptions {
+    int port = 8080;
+    size_t items = 1000;
+    uint64_t seed = 1;
+    int latencyMs = 0;
+    int jitterMs = 0;
+    size_t chunkSize = 0;
+    int chunkDelayMs = 0;
+    double throttleRate = 0;
+    double unavailableRate = 0;
+    double errorRate = 0;
+    double corruptRate = 0;
+    int retryAfter = 1;
+    bool gzip = false;
+    std::string apiKey;
+};
+
+/**
+ * Payload - One generated response body, ready to send.
+ */
+struct Payload {
+    std::string body;
+    std::string gzipped;
+    std::string etag;
+};
+
+/**
+ * gzipCompress - Compresses data into the gzip format (windowBits 15 + 16).
+ */
+std::string gzipCompress(const std::string& data) {
+    z_stream stream{};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("Failed to initialize zlib");
+    }
+
+    std::string out;
+    out.resize(deflateBound(&stream, data.size()));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+
+    int result = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    if (result != Z_STREAM_END) {
+        throw std::runtime_error("Failed to compress payload");
+    }
+    return out;
+}
+
+/**
+ * generateBody - The response for endpoint with items entries.
+ *
+ * projectWorkOrders gets full work orders from PayloadGenerator. Other
+ * endpoints get a short Id / Number / Name record per item, which is
+ * enough to exercise the client's handling of several endpoints.
+ */
+std::string generateBody(const std::string& endpoint, size_t items, uint64_t seed) {
+    if (endpoint == "projectWorkOrders") {
+        return PayloadGenerator(seed).generate(items);
+    }
+
+    std::string json = "{\"Items\":[";
+    for (size_t i = 0; i < items; i++) {
+        if (i > 0) json += ',';
+        std::string n = std::to_string(i + 1);
+        json += "{\"Id\":\"" + std::to_string(seed) + "-" + n + "\",\"Number\":\"" + n + "\",\"Name\":\"" + endpoint +
+                " " + n + "\"}";
+    }
+    json += "]}";
+    return json;
+}
+
+/**
+ * queryValue - The value of name in a query string like "items=10&x=y",
+ * or an empty string.
+ */
+std::string queryValue(const std::string& query, const std::string& name) {
+    std::stringstream stream(query);
+    std::string pair;
+    while (std::getline(stream, pair, '&')) {
+        size_t equals = pair.find('=');
+        if (pair.substr(0, equals) == name) {
+            return equals == std::string::npos ? "" : pair.substr(equals + 1);
+        }
+    }
+    return "";
+}
+
+/**
+ * MockApi - The request handler of the mock server.
+ *
+ *   1. Only GET /api/<endpoint> exists; the Api-Key header is checked if
+ *      --api-key was given
+ *   2. The configured latency (plus random jitter) passes before anything
+ *      is sent, like a slow server
+ *   3. A random draw decides whether the request is throttled (429), the
+ *      server is unavailable (503), both with Retry-After, fails (500),
+ *      or gets a body cut off half way (corrupt)
+ *   4. Bodies are generated once per endpoint and size and kept, so the
+ *      server measures the client and not the generator; ?items=N asks
+ *      for another size than --items, up to MAX_QUERY_ITEMS (or --items
+ *      if that is larger), and only the MAX_CACHED_PAYLOADS most recently
+ *      used bodies are kept
+ *   5. Responses carry an ETag and a matching If-None-Match gets a 304
+ *   6. With --gzip, clients that accept it get the compressed body
+ *   7. With --chunk-size the body is sent chunked, with --chunk-delay-ms
+ *      between the chunks
+ */
+class MockApi {
+public:
+    explicit MockApi(MockOptions options) : options(std::move(options)), random(this->options.seed) {}
+
+    HttpResponse operator()(const HttpRequest& request) {
+        HttpResponse response;
+        response.contentType = "application/json; charset=utf-8";
+
+        const std::string prefix = "/api/";
+        if (request.path.compare(0, prefix.size(), prefix) != 0 || request.path.size() == prefix.size()) {
+            return error(404, "Not found");
+        }
+        if (request.method != "GET" && request.method != "HEAD") {
+            return error(405, "Method not allowed");
+        }
+        if (!options.apiKey.empty() && request.header("api-key") != options.apiKey) {
+            return error(401, "Invalid API key");
+        }
+
+        int delay = options.latencyMs;
+        double draw = 0;
+        {
+            std::lock_guard<std::mutex> lock(randomMutex);
+            if (options.jitterMs > 0) {
+                delay += std::uniform_int_distribution<int>(0, options.jitterMs)(random);
+            }
+            draw = std::uniform_real_distribution<double>(0, 1)(random);
+        }
+        if (delay > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+        }
+
+        double threshold = options.throttleRate;
+        if (draw < threshold) return retryLater(429, "Too many requests");
+        threshold += options.unavailableRate;
+        if (draw < threshold) return retryLater(503, "Service unavailable");
+        threshold += options.errorRate;
+        if (draw < threshold) return error(500, "Internal server error");
+        threshold += options.corruptRate;
+        bool corrupt = draw < threshold;
+
+        std::string endpoint = request.path.substr(prefix.size());
+        size_t items = options.items;
+        std::string itemsParam = queryValue(request.query, "items");
+        if (!itemsParam.empty()) {
+            size_t maxItems = std::max(options.items, MAX_QUERY_ITEMS);
+            if (itemsParam.size() > 9 || itemsParam.find_first_not_of("0123456789") != std::string::npos ||
+                std::stoull(itemsParam) > maxItems) {
+                return error(400, "items must be a number up to " + std::to_string(maxItems));
+            }
+            items = std::stoull(itemsParam);
+        }
+        std::shared_ptr<const Payload> payload = payloadFor(endpoint, items);
+
+        response.headers.emplace_back("ETag", payload->etag);
+        if (request.header("if-none-match") == payload->etag) {
+            response.status = 304;
+            return response;
+        }
+
+        bool gzip = options.gzip && request.header("accept-encoding").find("gzip") != std::string::npos;
+        response.body = gzip ? payload->gzipped : payload->body;
+        if (gzip) {
+            response.headers.emplace_back("Content-Encoding", "gzip");
+        }
+        if (corrupt) {
+            response.body.resize(response.body.size() / 2);
+        }
+        response.chunkSize = options.chunkSize;
+        response.chunkDelay = std::chrono::milliseconds(options.chunkDelayMs);
+        return response;
+    }
+
+private:
+    // About 300 MB of generated JSON
+    static constexpr size_t MAX_QUERY_ITEMS = 100000;
+    static constexpr size_t MAX_CACHED_PAYLOADS = 4;
+
+    struct CachedPayload {
+        std::shared_ptr<const Payload> payload;
+        uint64_t lastUse = 0;
+    };
+
+    static HttpResponse error(int status, const std::string& message) {
+        HttpResponse response;
+        response.status = status;
+        response.contentType = "application/json; charset=utf-8";
+        response.body = "{\"Message\":\"" + message + "\"}";
+        return response;
+    }
+
+    HttpResponse retryLater(int status, const std::string& message) const {
+        HttpResponse response = error(status, message);
+        response.headers.emplace_back("Retry-After", std::to_string(options.retryAfter));
+        return response;
+    }
+
+    /**
+     * payloadFor - The cached payload for endpoint and items, generated
+     * (and compressed) on first use. Generation happens under the lock, so
+     * concurrent first requests for the same payload don't all build it.
+     * A full cache drops its least recently used payload first; responses
+     * still being sent keep their own copy.
+     */
+    std::shared_ptr<const Payload> payloadFor(const std::string& endpoint, size_t items) {
+        std::lock_guard<std::mutex> lock(payloadMutex);
+        auto key = std::make_pair(endpoint, items);
+        auto it = payloads.find(key);
+        if (it != payloads.end()) {
+            it->second.lastUse = ++useCount;
+            return it->second.payload;
+        }
+
+        if (payloads.size() >= MAX_CACHED_PAYLOADS) {
+            auto oldest = std::min_element(payloads.begin(), payloads.end(), [](const auto& a, const auto& b) {
+                return a.second.lastUse < b.second.lastUse;
+            });
+            payloads.erase(oldest);
+        }
+
+        auto payload = std::make_shared<Payload>();
+        payload->body = generateBody(endpoint, items, options.seed);
+        if (options.gzip) {
+            payload->gzipped = gzipCompress(payload->body);
+        }
+        char etag[32];
+        std::snprintf(etag, sizeof(etag), "\"%08lx-%zx\"",
+                      crc32(0, reinterpret_cast<const Bytef*>(payload->body.data()), static_cast<uInt>(payload->body.size())),
+                      payload->body.size());
+        payload->etag = etag;
+
+        payloads[key] = CachedPayload{payload, ++useCount};
+        return payload;
+    }
+
+    MockOptions options;
+    std::mutex randomMutex;
+    std::mt19937_64 random;
+    std::mutex payloadMutex;
+    std::map<std::pair<std::string, size_t>, CachedPayload> payloads;
+    uint64_t useCount = 0;
+};
+
+/**
+ * parseRate - Parses a rate flag and checks that it is between 0 and 1.
+ */
+double parseRate(const std::string& name, const std::string& value) {
+    double rate = std::stod(value);
+    if (rate < 0 || rate > 1) {
+        throw std::runtime_error(name + " must be between 0 and 1");
+    }
+    return rate;
+}
+
+/**
+ * parseMockOptions - Parses command line arguments into MockOptions.
+ * Every flag has the form --name=value, except --gzip.
+ */
+MockOptions parseMockOptions(int argc, char* argv[]) {
+    MockOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        std::string name = arg.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+
+        if (name == "--port") {
+            options.port = std::stoi(value);
+        } else if (name == "--items") {
+            options.items = std::stoull(value);
+        } else if (name == "--seed") {
+            options.seed = std::stoull(value);
+        } else if (name == "--latency-ms") {
+            options.latencyMs = std::stoi(value);
+        } else if (name == "--jitter-ms") {
+            options.jitterMs = std::stoi(value);
+        } else if (name == "--chunk-size") {
+            options.chunkSize = std::stoull(value);
+        } else if (name == "--chunk-delay-ms") {
+            options.chunkDelayMs = std::stoi(value);
+        } else if (name == "--throttle-rate") {
+            options.throttleRate = parseRate(name, value);
+        } else if (name == "--unavailable-rate") {
+            options.unavailableRate = parseRate(name, value);
+        } else if (name == "--error-rate") {
+            options.errorRate = parseRate(name, value);
+        } else if (name == "--corrupt-rate") {
+            options.corruptRate = parseRate(name, value);
+        } else if (name == "--retry-after") {
+            options.retryAfter = std::stoi(value);
+        } else if (name == "--gzip") {
+            options.gzip = true;
+        } else if (name == "--api-key") {
+            options.apiKey = value;
+        } else {
+            throw std::runtime_error("Unknown option: " + arg);
+        }
+    }
+
+    if (options.latencyMs < 0 || options.jitterMs < 0 || options.chunkDelayMs < 0 || options.retryAfter < 0) {
+        throw std::runtime_error("Times must not be negative");
+    }
+    return options;
+}
+
+/**
+ * main - Starts the mock server and runs until SIGINT or SIGTERM.
+ *
+ * The signals are blocked before any thread starts, so every thread
+ * inherits the mask and main can wait for them with sigwait.
+ */
+int main(int argc, char* argv[]) {
+    try {
+        MockOptions options = parseMockOptions(argc, argv);
+
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        auto api = std::make_shared<MockApi>(options);
+        HttpServer server("127.0.0.1", options.port, [api](const HttpRequest& request) { return (*api)(request); });
+        server.start();
+        std::cerr << "Mock Innergy API on http://127.0.0.1:" << server.port() << "/api/" << std::endl;
+
+        int signal = 0;
+        sigwait(&signals, &signal);
+        server.stop();
+    } catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,345 @@
+/**
+ * Payload Generator
+ *
+ * Builds synthetic projectWorkOrders responses of any size, so the JSON
+ * code can be measured and exercised without the live API.
+ *
+ *   1. Every item has every field of the WorkOrder struct the Go example
+ *      documents: Person references, MoneyValue and Margin objects,
+ *      CustomFields and Finishes, dates, tags and people lists
+ *   2. Values are drawn from small pools of realistic names, statuses and
+ *      facilities, like a real shop has, with lists of varying length.
+ *      People come from one staff list of 144, so the same Person shows
+ *      up on many work orders, as it does in a real tenant
+ *   3. Some strings need escaping (quotes, backslashes, line breaks, tabs,
+ *      non-ASCII text) and some dates are empty, like unfinished orders
+ *   4. The output only depends on the seed and the item count: the random
+ *      numbers come from splitmix64 rather than <random> distributions,
+ *      whose results differ between standard libraries
+ *
+ * A typical item is about 3 KB, so 1,000,000 items is about 3 GB.
+ *
+ * Header only, include it from bench.cpp and mock_server.cpp.
+ */
+
+#ifndef PAYLOAD_GENERATOR_H
+#define PAYLOAD_GENERATOR_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+class PayloadGenerator {
+public:
+    explicit PayloadGenerator(uint64_t seed = 1) : seed(seed) {}
+
+    /**
+     * generate - A complete response, {"Items":[...]}, with items work
+     * orders.
+     */
+    std::string generate(size_t items) const {
+        std::string json;
+        json.reserve(items * 3200 + 16);
+        json += "{\"Items\":[";
+        for (size_t i = 0; i < items; i++) {
+            if (i > 0) json += ',';
+            appendItem(json, i);
+        }
+        json += "]}";
+        return json;
+    }
+
+    /**
+     * appendItem - Appends work order number index. Each item gets its own
+     * random sequence, so item i is the same whatever the total count.
+     */
+    void appendItem(std::string& out, size_t index) const {
+        Random random(seed ^ (index * 0x9E3779B97F4A7C15ULL));
+        std::string number = std::to_string(10000 + index);
+        std::string currency = pick(random, CURRENCIES);
+
+        out += '{';
+        string(out, "Id", uuid(random), true);
+        string(out, "Number", "WO-" + number);
+        string(out, "Name", std::string(pick(random, PRODUCTS)) + ", unit " + number +
+                                (random.below(8) == 0 ? " \"rush\"" : ""));
+        string(out, "Type", pick(random, TYPES));
+        person(out, "CreatedBy", random);
+        string(out, "CreatedOn", date(random, 2024) + "T" + time(random));
+        string(out, "Facility", pick(random, FACILITIES));
+        literal(out, "Outsourced", random.below(10) == 0 ? "true" : "false");
+
+        name(out, "Tags");
+        out += '[';
+        for (uint64_t i = 0, n = random.below(4); i < n; i++) {
+            if (i > 0) out += ',';
+            quoted(out, pick(random, TAGS));
+        }
+        out += ']';
+
+        uint64_t step = random.below(STEP_COUNT);
+        string(out, "Status", pick(random, STATUSES));
+        literal(out, "MaterialOnHandDays", std::to_string(random.below(30)));
+        string(out, "Step", STEPS[step]);
+        literal(out, "StepIndex", std::to_string(step));
+        string(out, "StepType", step < 2 ? "Engineering" : "Production");
+        string(out, "InvoiceStatus", pick(random, INVOICE_STATUSES));
+        person(out, "Owner", random);
+        people(out, "Assignees", random, 4);
+        people(out, "Drafters", random, 2);
+        people(out, "Engineers", random, 2);
+        people(out, "Estimators", random, 2);
+        people(out, "SalesPersons", random, 2);
+        people(out, "Coordinators", random, 2);
+        people(out, "Installers", random, 3);
+        person(out, "ProjectManager", random);
+
+        bool finished = random.below(3) == 0;
+        std::string end = date(random, 2025);
+        string(out, "PlannedStartDate", date(random, 2025));
+        string(out, "ActualStartDate", random.below(4) == 0 ? "" : date(random, 2025));
+        string(out, "PlannedCriticalDate", date(random, 2025));
+        string(out, "MaterialNeededDate", date(random, 2025));
+        string(out, "PlannedEndMonth", end.substr(0, 7));
+        string(out, "ActualEndDate", finished ? end : "");
+        string(out, "ActualEndMonth", finished ? end.substr(0, 7) : "");
+        string(out, "Instructions", pick(random, INSTRUCTIONS));
+
+        double labor = money(random, 200, 20000);
+        double material = money(random, 100, 50000);
+        double cost = labor + material;
+        double price = cost * (1.2 + random.below(40) / 100.0);
+        double actual = cost * (0.8 + random.below(50) / 100.0);
+        moneyValue(out, "EstimatedLaborCost", labor, currency);
+        moneyValue(out, "EstimatedMaterialCost", material, currency);
+        moneyValue(out, "EstimatedCost", cost, currency);
+        string(out, "EstimatedHours", hours(random));
+        margin(out, "EstimatedMargin", price - cost, price, currency);
+        string(out, "RemainingHours", hours(random));
+        string(out, "PlannedHours", hours(random));
+        moneyValue(out, "PlannedLaborCost", labor, currency);
+        moneyValue(out, "LaborGrandTotalPrice", labor * 1.3, currency);
+        string(out, "ActualLaborHours", hours(random));
+        moneyValue(out, "ActualCost", actual, currency);
+        moneyValue(out, "ActualMaterialCost", actual - labor * 0.9, currency);
+        moneyValue(out, "ActualLaborCost", labor * 0.9, currency);
+        moneyValue(out, "ActualExpensesCost", money(random, 0, 500), currency);
+        margin(out, "ActualMargin", price - actual, price, currency);
+        moneyValue(out, "MarginVariance", cost - actual, currency);
+        moneyValue(out, "GrandTotalPrice", price * 1.08, currency);
+        moneyValue(out, "PreSalesTaxPrice", price, currency);
+        moneyValue(out, "SalesTax", price * 0.08, currency);
+        string(out, "ExternalIdentifier", random.below(2) == 0 ? "" : "ERP-" + std::to_string(random.below(1000000)));
+        string(out, "WorkflowName", pick(random, WORKFLOWS));
+        std::string project = std::to_string(2400 + random.below(600));
+        string(out, "ProjectNumber", "P-" + project);
+        string(out, "ProjectName", std::string(pick(random, CUSTOMERS)) + " - Project " + project);
+
+        name(out, "CustomFields");
+        out += '[';
+        for (uint64_t i = 0, n = random.below(4); i < n; i++) {
+            if (i > 0) out += ',';
+            out += '{';
+            string(out, "Name", CUSTOM_FIELDS[i], true);
+            literal(out, "Type", std::to_string(i + 1));
+            string(out, "Value", pick(random, CUSTOM_VALUES));
+            out += '}';
+        }
+        out += ']';
+
+        name(out, "Finishes");
+        out += '[';
+        for (uint64_t i = 0, n = random.below(3); i < n; i++) {
+            if (i > 0) out += ',';
+            uint64_t finish = random.below(sizeof(FINISHES) / sizeof(FINISHES[0]));
+            out += '{';
+            string(out, "Id", uuid(random), true);
+            string(out, "Name", FINISHES[finish]);
+            string(out, "Code", "F" + std::to_string(finish));
+            string(out, "Number", std::to_string(100 + finish));
+            out += '}';
+        }
+        out += ']';
+        out += '}';
+    }
+
+private:
+    /**
+     * Random - splitmix64, small and the same on every platform.
+     */
+    struct Random {
+        uint64_t state;
+
+        explicit Random(uint64_t seed) : state(seed) {}
+
+        uint64_t next() {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        uint64_t below(uint64_t n) {
+            return next() % n;
+        }
+    };
+
+    template <size_t N>
+    static const char* pick(Random& random, const char* const (&pool)[N]) {
+        return pool[random.below(N)];
+    }
+
+    static constexpr const char* FIRST_NAMES[] = {"Jane", "John", "Maria", "Ahmed", "Wei", "Olga", "Luis", "Priya",
+                                                 "Tom", "Chloé", "Kenji", "Sara"};
+    static constexpr const char* LAST_NAMES[] = {"Doe", "Smith", "García", "Khan", "Chen", "Ivanova", "Martin",
+                                                "Patel", "O'Brien", "Müller", "Tanaka", "Nowak"};
+    static constexpr const char* PRODUCTS[] = {"Kitchen cabinets", "Reception desk", "Vanity", "Built-in bookcase",
+                                              "Closet system", "Conference table", "Wall panels", "Millwork trim"};
+    static constexpr const char* TYPES[] = {"Standard", "Rework", "Warranty", "Sample"};
+    static constexpr const char* FACILITIES[] = {"Main Shop", "North Plant", "Finishing Center"};
+    static constexpr const char* TAGS[] = {"rush", "paint", "install", "veneer", "cnc", "hold", "customer-supplied"};
+    static constexpr const char* STATUSES[] = {"NotStarted", "InProgress", "InProgress", "OnHold", "Completed"};
+    static constexpr size_t STEP_COUNT = 7;
+    static constexpr const char* STEPS[STEP_COUNT] = {"Drafting", "Engineering", "Cutting", "Edgebanding",
+                                                      "Assembly", "Finishing", "Shipping"};
+    static constexpr const char* INVOICE_STATUSES[] = {"NotInvoiced", "PartiallyInvoiced", "Invoiced"};
+    static constexpr const char* WORKFLOWS[] = {"Casework", "Architectural Millwork", "Solid Surface", "Install Only"};
+    static constexpr const char* CUSTOMERS[] = {"Acme Dental", "Riverside Hotel", "City Library", "Oak & Ash Homes",
+                                               "Northwind Offices", "St. Mary's Clinic"};
+    static constexpr const char* INSTRUCTIONS[] = {
+        "",
+        "Use template from job 2231.",
+        "Line 1\nLine 2\tCheck C:\\shop\\cut list before cutting",
+        "Customer wants \"soft close\" hinges on all doors.\nDeliver before 8am.",
+        "Match grain across drawer fronts; see photos in project folder.",
+        "Größe prüfen – measure twice ✓"};
+    static constexpr const char* CUSTOM_FIELDS[] = {"Color", "Hardware", "Sheen"};
+    static constexpr const char* CUSTOM_VALUES[] = {"White", "Walnut", "Brushed Nickel", "Matte", "Satin 20°", "N/A"};
+    static constexpr const char* FINISHES[] = {"Clear Lacquer", "White Paint", "Walnut Stain", "Natural Oil"};
+    static constexpr const char* CURRENCIES[] = {"USD", "USD", "USD", "CAD", "EUR"};
+
+    static void name(std::string& out, const char* key, bool first = false) {
+        if (!first) out += ',';
+        out += '"';
+        out += key;
+        out += "\":";
+    }
+
+    /**
+     * quoted - Appends value as a JSON string. The pools only contain
+     * quotes, backslashes, line breaks and tabs, so that is all that is
+     * escaped; UTF-8 text goes through as is.
+     */
+    static void quoted(std::string& out, const std::string& value) {
+        out += '"';
+        for (char c : value) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\t': out += "\\t"; break;
+                default: out += c;
+            }
+        }
+        out += '"';
+    }
+
+    static void string(std::string& out, const char* key, const std::string& value, bool first = false) {
+        name(out, key, first);
+        quoted(out, value);
+    }
+
+    static void literal(std::string& out, const char* key, const std::string& value) {
+        name(out, key);
+        out += value;
+    }
+
+    /**
+     * personObject - Appends one member of the staff list. Their Id only
+     * depends on their place in the list.
+     */
+    static void personObject(std::string& out, Random& random) {
+        constexpr size_t firstNames = sizeof(FIRST_NAMES) / sizeof(FIRST_NAMES[0]);
+        constexpr size_t lastNames = sizeof(LAST_NAMES) / sizeof(LAST_NAMES[0]);
+        uint64_t member = random.below(firstNames * lastNames);
+        Random staff(member * 0x9E3779B97F4A7C15ULL + 0x5EED);
+        out += '{';
+        string(out, "Id", uuid(staff), true);
+        string(out, "FullName", std::string(FIRST_NAMES[member % firstNames]) + " " + LAST_NAMES[member / firstNames]);
+        out += '}';
+    }
+
+    static void person(std::string& out, const char* key, Random& random) {
+        name(out, key);
+        personObject(out, random);
+    }
+
+    static void people(std::string& out, const char* key, Random& random, uint64_t max) {
+        name(out, key);
+        out += '[';
+        for (uint64_t i = 0, n = random.below(max + 1); i < n; i++) {
+            if (i > 0) out += ',';
+            personObject(out, random);
+        }
+        out += ']';
+    }
+
+    static void moneyValue(std::string& out, const char* key, double value, const std::string& currency,
+                           bool first = false) {
+        name(out, key, first);
+        out += "{\"Value\":" + number(value) + ",\"OriginalValue\":" + number(value) + ",\"CurrencyCode\":";
+        quoted(out, currency);
+        out += '}';
+    }
+
+    static void margin(std::string& out, const char* key, double cash, double price, const std::string& currency) {
+        name(out, key);
+        out += '{';
+        moneyValue(out, "Cash", cash, currency, true);
+        literal(out, "Percentage", number(price != 0 ? cash / price * 100 : 0));
+        out += '}';
+    }
+
+    static std::string number(double value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.2f", value);
+        return buffer;
+    }
+
+    static double money(Random& random, uint64_t min, uint64_t max) {
+        return static_cast<double>(min * 100 + random.below((max - min) * 100)) / 100;
+    }
+
+    static std::string hours(Random& random) {
+        return number(static_cast<double>(random.below(40000)) / 100);
+    }
+
+    static std::string uuid(Random& random) {
+        uint64_t high = random.next();
+        uint64_t low = random.next();
+        char buffer[40];
+        std::snprintf(buffer, sizeof(buffer), "%08x-%04x-4%03x-%04x-%012llx", static_cast<unsigned>(high >> 32),
+                      static_cast<unsigned>((high >> 16) & 0xffff), static_cast<unsigned>(high & 0xfff),
+                      static_cast<unsigned>(0x8000 | ((low >> 48) & 0x3fff)),
+                      static_cast<unsigned long long>(low & 0xffffffffffffULL));
+        return buffer;
+    }
+
+    static std::string date(Random& random, int year) {
+        char buffer[16];
+        std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", year, static_cast<int>(1 + random.below(12)),
+                      static_cast<int>(1 + random.below(28)));
+        return buffer;
+    }
+
+    static std::string time(Random& random) {
+        char buffer[16];
+        std::snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d", static_cast<int>(random.below(24)),
+                      static_cast<int>(random.below(60)), static_cast<int>(random.below(60)));
+        return buffer;
+    }
+
+    uint64_t seed;
+};
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * Rate Limiter
+ *
+ * Paces requests on the client side, so a batch over many endpoints
+ * stays under the API's rate limit instead of running into 429s and
+ * retries, which make it slower than a paced batch.
+ *
+ *   1. TokenBucket allows ratePerSecond requests on average, with bursts
+ *      of up to burst requests at once
+ *   2. A request reserves its slot up front and is told how long to wait
+ *      for it, so waiting requests queue in arrival order
+ *   3. RateLimiter keeps one bucket per host and API key; clients for
+ *      different tenants of the same host don't share a budget
+ *
+ * TokenBucket is the "generic cell rate algorithm" form of a token
+ * bucket: instead of a token count and a refill time it keeps a single
+ * number, the theoretical arrival time of the next request, which is
+ * updated with one compare-and-swap. Reserving a slot never takes a lock.
+ *
+ * Header only, include it from innergy_client.h.
+ */
+
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+class TokenBucket {
+public:
+    TokenBucket(double ratePerSecond, double burst) {
+        check(ratePerSecond, burst);
+        interval = static_cast<int64_t>(1e9 / ratePerSecond);
+        tolerance = static_cast<int64_t>((burst - 1) * static_cast<double>(interval));
+    }
+
+    /**
+     * check - Throws unless ratePerSecond and burst make a usable bucket.
+     */
+    static void check(double ratePerSecond, double burst) {
+        if (!(ratePerSecond > 0) || !(burst >= 1)) {
+            throw std::runtime_error("Rate limit needs a positive rate and a burst of at least 1");
+        }
+    }
+
+    /**
+     * reserve - Takes the next free slot and returns how long to wait for
+     * it; zero if a token is available right now.
+     *
+     *   1. The slot starts at the theoretical arrival time, or now if that
+     *      has passed (the bucket is full)
+     *   2. Up to tolerance (burst - 1 intervals) ahead of it can go at once
+     *   3. The next theoretical arrival time is one interval later
+     */
+    std::chrono::nanoseconds reserve() {
+        int64_t now = nowNs();
+        int64_t arrival = theoreticalArrival.load(std::memory_order_relaxed);
+        int64_t start;
+        int64_t next;
+        do {
+            int64_t base = std::max(arrival, now);
+            start = std::max(now, base - tolerance);
+            next = base + interval;
+        } while (!theoreticalArrival.compare_exchange_weak(arrival, next, std::memory_order_relaxed));
+        return std::chrono::nanoseconds(start - now);
+    }
+
+    /**
+     * currentWait - How long a request arriving now would have to wait,
+     * i.e. the length of the queue in time.
+     */
+    std::chrono::nanoseconds currentWait() const {
+        int64_t now = nowNs();
+        int64_t arrival = theoreticalArrival.load(std::memory_order_relaxed);
+        return std::chrono::nanoseconds(std::max<int64_t>(0, std::max(arrival, now) - tolerance - now));
+    }
+
+private:
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    int64_t interval;
+    int64_t tolerance;
+    std::atomic<int64_t> theoreticalArrival{0};
+};
+
+/**
+ * RateLimiter - One TokenBucket per host and API key, all with the same
+ * rate and burst.
+ *
+ * bucket() takes a mutex, but only to find or create the bucket; the
+ * reference it returns stays valid for the life of the limiter, so
+ * callers look their bucket up once and then reserve without locking.
+ */
+class RateLimiter {
+public:
+    RateLimiter(double ratePerSecond, double burst) : ratePerSecond(ratePerSecond), burst(burst) {
+        TokenBucket::check(ratePerSecond, burst);
+    }
+
+    TokenBucket& bucket(const std::string& host, const std::string& apiKey) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unique_ptr<TokenBucket>& entry = buckets[host + '\n' + apiKey];
+        if (!entry) {
+            entry = std::make_unique<TokenBucket>(ratePerSecond, burst);
+        }
+        return *entry;
+    }
+
+    /**
+     * hostOf - The host (and port) part of a URL like
+     * "https://app.innergy.com/api/".
+     */
+    static std::string hostOf(const std::string& url) {
+        size_t begin = url.find("://");
+        begin = begin == std::string::npos ? 0 : begin + 3;
+        size_t end = url.find('/', begin);
+        return url.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+    }
+
+private:
+    double ratePerSecond;
+    double burst;
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<TokenBucket>> buckets;
+};
+
+#endif
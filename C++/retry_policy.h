@@ -0,0 +1,166 @@
+/**
+ * Retry Policy
+ *
+ * Decides whether a failed request is worth another attempt and how long
+ * to wait first, so one transient 503 doesn't fail a whole run.
+ *
+ *   1. Only failures that can go away on their own are retried: timeouts,
+ *      dropped connections, 408, 429, 500, 502, 503 and 504
+ *   2. The wait grows exponentially from baseDelay, is capped at maxDelay
+ *      and is then drawn uniformly between 0 and that value ("full
+ *      jitter"), so clients that failed together don't retry together
+ *   3. A Retry-After header, in seconds or as an HTTP date, replaces the
+ *      computed wait; the server knows best when it can take more
+ *   4. All attempts and waits together stay within the deadline: no retry
+ *      is started that couldn't finish in time, and each attempt's timeout
+ *      is cut to what is left
+ *
+ * Header only, include it from innergy_client.h.
+ */
+
+#ifndef RETRY_POLICY_H
+#define RETRY_POLICY_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <string>
+#include <string_view>
+#include <curl/curl.h>
+
+/**
+ * RetryPolicy - How often and how patiently to retry. maxRetries 0 turns
+ * retrying off.
+ */
+struct RetryPolicy {
+    int maxRetries = 3;
+    std::chrono::milliseconds baseDelay{500};
+    std::chrono::milliseconds maxDelay{30000};
+    std::chrono::milliseconds deadline{300000};
+
+    /**
+     * retryable - True for failures that another attempt may not hit.
+     * httpCode is only looked at if the transfer itself succeeded.
+     */
+    static bool retryable(CURLcode curlCode, long httpCode) {
+        switch (curlCode) {
+            case CURLE_OK:
+                return httpCode == 408 || httpCode == 429 || httpCode == 500 || httpCode == 502 ||
+                       httpCode == 503 || httpCode == 504;
+            case CURLE_COULDNT_RESOLVE_HOST:
+            case CURLE_COULDNT_CONNECT:
+            case CURLE_OPERATION_TIMEDOUT:
+            case CURLE_SEND_ERROR:
+            case CURLE_RECV_ERROR:
+            case CURLE_GOT_NOTHING:
+            case CURLE_PARTIAL_FILE:
+            case CURLE_HTTP2:
+            case CURLE_HTTP2_STREAM:
+            case CURLE_SSL_CONNECT_ERROR:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * backoff - The wait before retry number retry (1 for the first), with
+     * full jitter: uniform in [0, min(maxDelay, baseDelay * 2^(retry-1))].
+     */
+    std::chrono::milliseconds backoff(int retry) const {
+        long long ceiling = baseDelay.count();
+        for (int i = 1; i < retry && ceiling < maxDelay.count(); i++) {
+            ceiling *= 2;
+        }
+        ceiling = std::min<long long>(ceiling, maxDelay.count());
+
+        thread_local std::mt19937_64 random(std::random_device{}());
+        return std::chrono::milliseconds(std::uniform_int_distribution<long long>(0, ceiling)(random));
+    }
+};
+
+/**
+ * parseRetryAfter - Parses a Retry-After value relative to now.
+ *
+ * The header is either a number of seconds ("120") or an HTTP date
+ * ("Wed, 21 Oct 2015 07:28:00 GMT"), which curl_getdate understands. A
+ * date in the past means no wait. Returns false if value is neither.
+ */
+inline bool parseRetryAfter(std::string_view value, std::time_t now, std::chrono::milliseconds& wait) {
+    std::string text(value);
+    if (text.empty()) return false;
+
+    if (text.find_first_not_of("0123456789") == std::string::npos) {
+        wait = std::chrono::seconds(std::strtoll(text.c_str(), nullptr, 10));
+        return true;
+    }
+
+    std::time_t at = curl_getdate(text.c_str(), nullptr);
+    if (at == -1) return false;
+    wait = std::chrono::seconds(std::max<long long>(0, static_cast<long long>(at - now)));
+    return true;
+}
+
+/**
+ * RetrySchedule - The retry state of one request, from its first attempt
+ * until it succeeds or gives up.
+ *
+ *   1. Created when the first attempt starts, which starts the deadline
+ *   2. next() is asked after every failed attempt; it returns the wait
+ *      before the next attempt, or false to give up
+ *   3. attemptTimeout() is the time the next attempt may take
+ */
+class RetrySchedule {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RetrySchedule(const RetryPolicy& policy) : policy(policy), start(Clock::now()) {}
+
+    /**
+     * next - Decides on a retry after an attempt failed with curlCode /
+     * httpCode. retryAfter is the response's Retry-After header, if any.
+     * On true, wait is how long to sleep before retrying and the retry is
+     * counted.
+     */
+    bool next(CURLcode curlCode, long httpCode, std::string_view retryAfter, std::chrono::milliseconds& wait) {
+        if (retryCount >= policy.maxRetries || !RetryPolicy::retryable(curlCode, httpCode)) {
+            return false;
+        }
+
+        if (!parseRetryAfter(retryAfter, std::time(nullptr), wait)) {
+            wait = policy.backoff(retryCount + 1);
+        }
+
+        // A retry needs time to run too; don't start one that can only
+        // time out
+        if (Clock::now() + wait + MIN_ATTEMPT_TIME > start + policy.deadline) {
+            return false;
+        }
+
+        retryCount++;
+        return true;
+    }
+
+    /**
+     * attemptTimeout - The time left until the deadline, at most cap.
+     */
+    std::chrono::milliseconds attemptTimeout(std::chrono::milliseconds cap) const {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(start + policy.deadline - Clock::now());
+        return std::max(std::chrono::milliseconds(1), std::min(cap, left));
+    }
+
+    int retries() const {
+        return retryCount;
+    }
+
+private:
+    static constexpr std::chrono::milliseconds MIN_ATTEMPT_TIME{1000};
+
+    RetryPolicy policy;
+    Clock::time_point start;
+    int retryCount = 0;
+};
+
+#endif
@@ -0,0 +1,411 @@
+/**
+ * Snapshot Cache
+ *
+ * Keeps the body of the last response on disk together with the time it
+ * was fetched and its ETag / Last-Modified validators, so runs that can
+ * live with slightly old data don't have to download the whole dataset
+ * again, and the others can ask the server whether it changed.
+ *
+ * A snapshot also records where it came from: the endpoint, the base URL
+ * and a hash of the API key. It is only used for requests to the same
+ * place with the same key, so a run against mock_server or with another
+ * tenant's key never sees it.
+ *
+ * A snapshot file starts with a 4096 byte header block of text lines,
+ * ended by a blank line and padded with spaces, followed by the body
+ * exactly as it was received:
+ *
+ *   work_orders snapshot 1
+ *   endpoint: projectWorkOrders
+ *   base-url: https://app.innergy.com/api/
+ *   key-hash: 8f1c2e0b6a9d4f37
+ *   fetched-at: 1760000000
+ *   etag: "5d8c72a5edda8d6a"
+ *   last-modified: Wed, 15 Oct 2025 07:28:00 GMT
+ *   length: 52113
+ *
+ *   {"Items":[...
+ *
+ * The header block has a fixed size so it can be filled in after the body
+ * has been written, when the validators and the length are known.
+ *
+ * Files are written to a temporary name and renamed into place, so a
+ * reader never sees half a snapshot; that includes the new fetch time
+ * after a 304, which writes a whole new file rather than touching the one
+ * other processes may have mapped. Files are read back with mmap, so
+ * serving a snapshot doesn't copy the body.
+ *
+ * Header only, include it from work_orders.cpp.
+ */
+
+#ifndef SNAPSHOT_CACHE_H
+#define SNAPSHOT_CACHE_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * SnapshotInfo - The header fields of a snapshot.
+ */
+struct SnapshotInfo {
+    std::string endpoint;
+    std::string baseUrl;
+    std::string keyHash;
+    std::time_t fetchedAt = 0;
+    std::string etag;
+    std::string lastModified;
+
+    /**
+     * sameSource - True if both are for the same endpoint, base URL and
+     * API key.
+     */
+    bool sameSource(const SnapshotInfo& other) const {
+        return endpoint == other.endpoint && baseUrl == other.baseUrl && keyHash == other.keyHash;
+    }
+};
+
+/**
+ * hashApiKey - The key-hash of a snapshot fetched with apiKey: the hex of
+ * its 64-bit FNV-1a hash. It tells keys apart without storing them, and
+ * unlike std::hash it is the same in every build.
+ */
+inline std::string hashApiKey(std::string_view apiKey) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : apiKey) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+namespace snapshot_detail {
+
+constexpr size_t HEADER_SIZE = 4096;
+
+/**
+ * formatHeader - Builds the header block for info and a body of length
+ * bytes. Returns an empty string if a field contains a line break.
+ * Validators that don't fit in the block are left out; the next fetch is
+ * then simply unconditional.
+ */
+inline std::string formatHeader(const SnapshotInfo& info, size_t length) {
+    for (const std::string* value : {&info.endpoint, &info.baseUrl, &info.keyHash, &info.etag, &info.lastModified}) {
+        if (value->find_first_of("\r\n") != std::string::npos) return "";
+    }
+
+    auto field = [](const char* name, const std::string& value) {
+        return value.empty() ? std::string() : std::string(name) + ": " + value + "\n";
+    };
+
+    std::string first = "work_orders snapshot 1\n" + field("endpoint", info.endpoint) +
+                        field("base-url", info.baseUrl) + field("key-hash", info.keyHash) + "fetched-at: " + std::to_string(static_cast<long long>(info.fetchedAt)) + "\n";
+    std::string validators = field("etag", info.etag) + field("last-modified", info.lastModified);
+    std::string last = "length: " + std::to_string(length) + "\n";
+
+    if (first.size() + validators.size() + last.size() + 2 > HEADER_SIZE) {
+        validators.clear();
+    }
+    std::string header = first + validators + last;
+    if (header.size() + 2 > HEADER_SIZE) return "";
+
+    header += '\n';
+    header.resize(HEADER_SIZE - 1, ' ');
+    header += '\n';
+    return header;
+}
+
+/**
+ * writeHeader - Writes the header block at the start of fd.
+ */
+inline bool writeHeader(int fd, const SnapshotInfo& info, size_t length) {
+    std::string header = formatHeader(info, length);
+    if (header.empty()) {
+        errno = EINVAL;
+        return false;
+    }
+    return pwrite(fd, header.data(), header.size(), 0) == static_cast<ssize_t>(header.size());
+}
+
+}
+
+/**
+ * MappedSnapshot - A snapshot file mapped into memory.
+ *
+ * body() points into the mapping, so it is only valid as long as the
+ * MappedSnapshot lives. The mapping is removed by the destructor.
+ */
+class MappedSnapshot {
+public:
+    /**
+     * load - Maps the snapshot at path if it is one of source (see
+     * SnapshotInfo::sameSource).
+     *
+     *   1. Opens and maps the whole file read only
+     *   2. Checks the first line and reads the header fields up to the
+     *      blank line; unknown fields are skipped
+     *   3. Checks that the length field matches the bytes after the header
+     *      block, so a truncated file is never served
+     *   4. Checks that the endpoint, base URL and key hash are the ones of
+     *      source; a snapshot without them is from before they were
+     *      recorded and doesn't match either
+     *
+     * Returns nullptr if there is no snapshot or it can't be used.
+     */
+    static std::unique_ptr<MappedSnapshot> load(const std::string& path, const SnapshotInfo& source) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return nullptr;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < snapshot_detail::HEADER_SIZE) {
+            ::close(fd);
+            return nullptr;
+        }
+
+        size_t size = static_cast<size_t>(st.st_size);
+        void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) return nullptr;
+
+        std::unique_ptr<MappedSnapshot> snapshot(new MappedSnapshot(map, size));
+        if (!snapshot->parse() || !snapshot->info().sameSource(source)) return nullptr;
+        return snapshot;
+    }
+
+    ~MappedSnapshot() {
+        munmap(map, mapSize);
+    }
+
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+    const SnapshotInfo& info() const {
+        return snapshotInfo;
+    }
+
+    std::string_view body() const {
+        return snapshotBody;
+    }
+
+    /**
+     * age - Seconds since the body was fetched.
+     */
+    long long age() const {
+        return static_cast<long long>(std::time(nullptr) - snapshotInfo.fetchedAt);
+    }
+
+    /**
+     * freshFor - True if this is a snapshot of source that is at most
+     * maxAge seconds old. A fetch time in the future never counts as fresh.
+     */
+    bool freshFor(const SnapshotInfo& source, long long maxAge) const {
+        long long seconds = age();
+        return snapshotInfo.sameSource(source) && seconds >= 0 && seconds <= maxAge;
+    }
+
+private:
+    MappedSnapshot(void* map, size_t mapSize) : map(map), mapSize(mapSize) {}
+
+    bool parse() {
+        std::string_view text(static_cast<const char*>(map), mapSize);
+        std::string_view header = text.substr(0, snapshot_detail::HEADER_SIZE);
+        std::string_view line;
+        size_t pos = 0;
+
+        auto nextLine = [&]() {
+            size_t end = header.find('\n', pos);
+            if (end == std::string_view::npos) return false;
+            line = header.substr(pos, end - pos);
+            pos = end + 1;
+            return true;
+        };
+
+        if (!nextLine() || line != "work_orders snapshot 1") return false;
+
+        bool haveLength = false;
+        unsigned long long length = 0;
+
+        while (true) {
+            if (!nextLine()) return false;
+            if (line.empty()) break;
+
+            size_t colon = line.find(": ");
+            if (colon == std::string_view::npos) return false;
+            std::string_view name = line.substr(0, colon);
+            std::string value(line.substr(colon + 2));
+
+            if (name == "endpoint") {
+                snapshotInfo.endpoint = value;
+            } else if (name == "base-url") {
+                snapshotInfo.baseUrl = value;
+            } else if (name == "key-hash") {
+                snapshotInfo.keyHash = value;
+            } else if (name == "fetched-at") {
+                snapshotInfo.fetchedAt = static_cast<std::time_t>(std::strtoll(value.c_str(), nullptr, 10));
+            } else if (name == "etag") {
+                snapshotInfo.etag = value;
+            } else if (name == "last-modified") {
+                snapshotInfo.lastModified = value;
+            } else if (name == "length") {
+                length = std::strtoull(value.c_str(), nullptr, 10);
+                haveLength = true;
+            }
+        }
+
+        if (!haveLength || length != mapSize - snapshot_detail::HEADER_SIZE) return false;
+
+        snapshotBody = text.substr(snapshot_detail::HEADER_SIZE);
+        return true;
+    }
+
+    void* map;
+    size_t mapSize;
+    SnapshotInfo snapshotInfo;
+    std::string_view snapshotBody;
+};
+
+/**
+ * SnapshotWriter - Writes a snapshot, either in one go or chunk by chunk
+ * while a response downloads.
+ *
+ *   1. The constructor creates path.tmp.<pid>.<n>, n counting the writers
+ *      of this process so two of them never share a file, and leaves room
+ *      for the header block. The file holds the tenant's work orders, so
+ *      only its owner may read it (0600)
+ *   2. append() writes body bytes straight to the file
+ *   3. commit() writes the header block, now that the validators and the
+ *      length are known, and renames the file over path
+ *   4. A writer that is destroyed without commit() removes its file, so
+ *      a failed transfer leaves the previous snapshot in place
+ *
+ * The snapshot is only an optimization, so errors don't throw: the first
+ * one stops the writer and is kept in error(), like FetchResult does.
+ */
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const std::string& path)
+        : path(path), tmpPath(path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(nextWriter())) {
+        fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            fail("Failed to create snapshot file " + tmpPath);
+            return;
+        }
+        if (lseek(fd, static_cast<off_t>(snapshot_detail::HEADER_SIZE), SEEK_SET) < 0) {
+            fail("Failed to write snapshot file " + tmpPath);
+        }
+    }
+
+    ~SnapshotWriter() {
+        if (fd >= 0) {
+            ::close(fd);
+            ::unlink(tmpPath.c_str());
+        }
+    }
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    void append(const char* data, size_t size) {
+        writeAll(data, size);
+        bodyLength += size;
+    }
+
+    void append(std::string_view data) {
+        append(data.data(), data.size());
+    }
+
+    /**
+     * commit - Writes the header for info, closes the file and moves it
+     * into place. Returns ok().
+     */
+    bool commit(const SnapshotInfo& info) {
+        if (fd < 0) return false;
+
+        if (ok() && !snapshot_detail::writeHeader(fd, info, bodyLength)) {
+            fail("Failed to write snapshot file " + tmpPath);
+        }
+
+        int result = ::close(fd);
+        fd = -1;
+        if (ok() && result != 0) {
+            fail("Failed to write snapshot file " + tmpPath);
+        }
+        if (ok() && std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+            fail("Failed to replace snapshot file " + path);
+        }
+        if (!ok()) {
+            ::unlink(tmpPath.c_str());
+        }
+        return ok();
+    }
+
+    /**
+     * refresh - Replaces the snapshot at path with body under a new header,
+     * e.g. with a new fetch time after the server answered 304. body is
+     * usually the mapping of the current snapshot, which stays valid
+     * after the rename; it goes through a temporary file like any other
+     * snapshot, so readers see the old file or the new one.
+     */
+    static bool refresh(const std::string& path, const SnapshotInfo& info, std::string_view body, std::string& error) {
+        SnapshotWriter writer(path);
+        writer.append(body);
+        if (!writer.commit(info)) {
+            error = writer.error();
+            return false;
+        }
+        return true;
+    }
+
+    bool ok() const {
+        return failure.empty();
+    }
+
+    const std::string& error() const {
+        return failure;
+    }
+
+private:
+    static unsigned nextWriter() {
+        static std::atomic<unsigned> count{0};
+        return count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void writeAll(const char* data, size_t size) {
+        while (ok() && size > 0) {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                fail("Failed to write snapshot file " + tmpPath);
+                return;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+    void fail(const std::string& message) {
+        if (ok()) failure = message + ": " + std::strerror(errno);
+    }
+
+    std::string path;
+    std::string tmpPath;
+    int fd = -1;
+    size_t bodyLength = 0;
+    std::string failure;
+};
+
+#endif
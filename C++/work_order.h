@@ -0,0 +1,732 @@
+/**
+ * Work Order Model
+ *
+ * Typed C++ version of the structs the Go example decodes into (Person,
+ * MoneyValue, Margin, CustomField, Finish, WorkOrder), plus a hand-written
+ * decoder that reads the "Items" array straight into a
+ * std::vector<WorkOrder> from JsonStreamParser events. Downstream code can
+ * then filter and aggregate on fields without parsing the text again.
+ *
+ * Strings are std::string_views and lists ArenaVectors. A string without
+ * escapes points straight into the response it was decoded from, when the
+ * whole response stays in memory; other strings and all lists are in the
+ * Arena of the WorkOrderBatch. A batch is freed in one go and the work
+ * orders must not outlive it, or the response. Fields that repeat across
+ * work orders (Status, Facility, Step, StepType, InvoiceStatus,
+ * WorkflowName, CurrencyCode and people) are InternedStrings instead, in
+ * the InternTable of the batch.
+ *
+ * Header only, include it from work_orders.cpp.
+ */
+
+#ifndef WORK_ORDER_H
+#define WORK_ORDER_H
+
+#include <charconv>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "arena.h"
+#include "intern_table.h"
+#include "json_stream.h"
+#include "json_writer.h"
+
+// Person represents a user reference in the API response
+struct Person {
+    InternedString Id;
+    InternedString FullName;
+};
+
+// MoneyValue represents a monetary amount
+struct MoneyValue {
+    double Value = 0;
+    double OriginalValue = 0;
+    InternedString CurrencyCode;
+};
+
+// Margin represents margin data with cash and percentage
+struct Margin {
+    MoneyValue Cash;
+    double Percentage = 0;
+};
+
+// CustomField represents a custom field entry
+struct CustomField {
+    std::string_view Name;
+    int Type = 0;
+    std::string_view Value;
+};
+
+// Finish represents a finish option
+struct Finish {
+    std::string_view Id;
+    std::string_view Name;
+    std::string_view Code;
+    std::string_view Number;
+};
+
+// WorkOrder represents a work order from the API. Its strings and lists
+// belong to the WorkOrderBatch it was decoded into
+struct WorkOrder {
+    std::string_view Id;
+    std::string_view Number;
+    std::string_view Name;
+    std::string_view Type;
+    Person CreatedBy;
+    std::string_view CreatedOn;
+    InternedString Facility;
+    bool Outsourced = false;
+    ArenaVector<std::string_view> Tags;
+    InternedString Status;
+    int MaterialOnHandDays = 0;
+    InternedString Step;
+    int StepIndex = 0;
+    InternedString StepType;
+    InternedString InvoiceStatus;
+    Person Owner;
+    ArenaVector<Person> Assignees;
+    ArenaVector<Person> Drafters;
+    ArenaVector<Person> Engineers;
+    ArenaVector<Person> Estimators;
+    ArenaVector<Person> SalesPersons;
+    ArenaVector<Person> Coordinators;
+    ArenaVector<Person> Installers;
+    Person ProjectManager;
+    std::string_view PlannedStartDate;
+    std::string_view ActualStartDate;
+    std::string_view PlannedCriticalDate;
+    std::string_view MaterialNeededDate;
+    std::string_view PlannedEndMonth;
+    std::string_view ActualEndDate;
+    std::string_view ActualEndMonth;
+    std::string_view Instructions;
+    MoneyValue EstimatedLaborCost;
+    MoneyValue EstimatedMaterialCost;
+    MoneyValue EstimatedCost;
+    std::string_view EstimatedHours;
+    Margin EstimatedMargin;
+    std::string_view RemainingHours;
+    std::string_view PlannedHours;
+    MoneyValue PlannedLaborCost;
+    MoneyValue LaborGrandTotalPrice;
+    std::string_view ActualLaborHours;
+    MoneyValue ActualCost;
+    MoneyValue ActualMaterialCost;
+    MoneyValue ActualLaborCost;
+    MoneyValue ActualExpensesCost;
+    Margin ActualMargin;
+    MoneyValue MarginVariance;
+    MoneyValue GrandTotalPrice;
+    MoneyValue PreSalesTaxPrice;
+    MoneyValue SalesTax;
+    std::string_view ExternalIdentifier;
+    InternedString WorkflowName;
+    std::string_view ProjectNumber;
+    std::string_view ProjectName;
+    ArenaVector<CustomField> CustomFields;
+    ArenaVector<Finish> Finishes;
+};
+
+/**
+ * WorkOrderMember - Pointer to one WorkOrder field, tagged by its type.
+ *
+ * The decoder looks up each JSON key once in a static table of these and
+ * writes the value through the member pointer, so there is no long chain
+ * of string compares per key.
+ */
+using WorkOrderMember = std::variant<
+    std::string_view WorkOrder::*,
+    InternedString WorkOrder::*,
+    bool WorkOrder::*,
+    int WorkOrder::*,
+    Person WorkOrder::*,
+    ArenaVector<Person> WorkOrder::*,
+    MoneyValue WorkOrder::*,
+    Margin WorkOrder::*,
+    ArenaVector<std::string_view> WorkOrder::*,
+    ArenaVector<CustomField> WorkOrder::*,
+    ArenaVector<Finish> WorkOrder::*>;
+
+/**
+ * workOrderFields - JSON key to WorkOrder member table, built once.
+ */
+inline const std::unordered_map<std::string_view, WorkOrderMember>& workOrderFields() {
+    static const std::unordered_map<std::string_view, WorkOrderMember> fields = {
+        {"Id", &WorkOrder::Id},
+        {"Number", &WorkOrder::Number},
+        {"Name", &WorkOrder::Name},
+        {"Type", &WorkOrder::Type},
+        {"CreatedBy", &WorkOrder::CreatedBy},
+        {"CreatedOn", &WorkOrder::CreatedOn},
+        {"Facility", &WorkOrder::Facility},
+        {"Outsourced", &WorkOrder::Outsourced},
+        {"Tags", &WorkOrder::Tags},
+        {"Status", &WorkOrder::Status},
+        {"MaterialOnHandDays", &WorkOrder::MaterialOnHandDays},
+        {"Step", &WorkOrder::Step},
+        {"StepIndex", &WorkOrder::StepIndex},
+        {"StepType", &WorkOrder::StepType},
+        {"InvoiceStatus", &WorkOrder::InvoiceStatus},
+        {"Owner", &WorkOrder::Owner},
+        {"Assignees", &WorkOrder::Assignees},
+        {"Drafters", &WorkOrder::Drafters},
+        {"Engineers", &WorkOrder::Engineers},
+        {"Estimators", &WorkOrder::Estimators},
+        {"SalesPersons", &WorkOrder::SalesPersons},
+        {"Coordinators", &WorkOrder::Coordinators},
+        {"Installers", &WorkOrder::Installers},
+        {"ProjectManager", &WorkOrder::ProjectManager},
+        {"PlannedStartDate", &WorkOrder::PlannedStartDate},
+        {"ActualStartDate", &WorkOrder::ActualStartDate},
+        {"PlannedCriticalDate", &WorkOrder::PlannedCriticalDate},
+        {"MaterialNeededDate", &WorkOrder::MaterialNeededDate},
+        {"PlannedEndMonth", &WorkOrder::PlannedEndMonth},
+        {"ActualEndDate", &WorkOrder::ActualEndDate},
+        {"ActualEndMonth", &WorkOrder::ActualEndMonth},
+        {"Instructions", &WorkOrder::Instructions},
+        {"EstimatedLaborCost", &WorkOrder::EstimatedLaborCost},
+        {"EstimatedMaterialCost", &WorkOrder::EstimatedMaterialCost},
+        {"EstimatedCost", &WorkOrder::EstimatedCost},
+        {"EstimatedHours", &WorkOrder::EstimatedHours},
+        {"EstimatedMargin", &WorkOrder::EstimatedMargin},
+        {"RemainingHours", &WorkOrder::RemainingHours},
+        {"PlannedHours", &WorkOrder::PlannedHours},
+        {"PlannedLaborCost", &WorkOrder::PlannedLaborCost},
+        {"LaborGrandTotalPrice", &WorkOrder::LaborGrandTotalPrice},
+        {"ActualLaborHours", &WorkOrder::ActualLaborHours},
+        {"ActualCost", &WorkOrder::ActualCost},
+        {"ActualMaterialCost", &WorkOrder::ActualMaterialCost},
+        {"ActualLaborCost", &WorkOrder::ActualLaborCost},
+        {"ActualExpensesCost", &WorkOrder::ActualExpensesCost},
+        {"ActualMargin", &WorkOrder::ActualMargin},
+        {"MarginVariance", &WorkOrder::MarginVariance},
+        {"GrandTotalPrice", &WorkOrder::GrandTotalPrice},
+        {"PreSalesTaxPrice", &WorkOrder::PreSalesTaxPrice},
+        {"SalesTax", &WorkOrder::SalesTax},
+        {"ExternalIdentifier", &WorkOrder::ExternalIdentifier},
+        {"WorkflowName", &WorkOrder::WorkflowName},
+        {"ProjectNumber", &WorkOrder::ProjectNumber},
+        {"ProjectName", &WorkOrder::ProjectName},
+        {"CustomFields", &WorkOrder::CustomFields},
+        {"Finishes", &WorkOrder::Finishes},
+    };
+    return fields;
+}
+
+/**
+ * WorkOrderBatch - The work orders decoded from one response, and the
+ * arena and intern table that hold their strings and lists.
+ *
+ * The arena and the table are on the heap so moving a batch doesn't move
+ * them. items is declared last, so it is destroyed before them. response
+ * keeps the response alive when the batch points into one it shares.
+ */
+struct WorkOrderBatch {
+    std::shared_ptr<const std::string> response;
+    std::unique_ptr<Arena> arena = std::make_unique<Arena>();
+    std::unique_ptr<InternTable> strings = std::make_unique<InternTable>();
+    std::vector<WorkOrder> items;
+};
+
+/**
+ * WorkOrderDecoder - JsonHandler that fills a vector of WorkOrders.
+ *
+ *   1. Keeps a stack of frames, one per open object or array, each saying
+ *      what kind of value it is (work order, person, money, ...) and
+ *      where it is stored
+ *   2. key() remembers which field the next value belongs to
+ *   3. startObject/startArray push a frame for the field's type, or a
+ *      Skip frame for keys we don't model
+ *   4. Scalar events write straight into the field. Strings that lie in
+ *      source are kept as views into it, all others are copied into the
+ *      arena of the batch; lists allocate from the arena too
+ *   5. InternedString fields are interned in the InternTable of the
+ *      batch, so a repeated value is stored once and the table is freed
+ *      with the batch
+ *
+ * The parser hands over strings without escapes as views into the chunk
+ * it was fed, and only decodes the others into a scratch buffer. When the
+ * whole response is in one buffer that outlives the batch, pass it as
+ * source and those views are used as they are: for a typical response
+ * that is every Id, Number, Status and date, and nothing is copied. When
+ * it is fed chunks that are reused (fetchStreaming), leave source empty.
+ *
+ * Accepts both {"Items": [...]} and a bare top level array. Works with
+ * any chunking, so it can run on top of InnergyClient::fetchStreaming.
+ */
+class WorkOrderDecoder : public JsonHandler {
+public:
+    explicit WorkOrderDecoder(WorkOrderBatch& batch, std::string_view source = {})
+        : items(batch.items), arena(*batch.arena), strings(*batch.strings), source(source) {}
+
+    void startObject() override {
+        if (frames.empty()) {
+            frames.push_back({Kind::Root, nullptr});
+            return;
+        }
+
+        Frame& top = frames.back();
+        switch (top.kind) {
+            case Kind::Items:
+                items.emplace_back();
+                frames.push_back({Kind::WorkOrder, &items.back()});
+                return;
+            case Kind::WorkOrder:
+                if (auto member = std::get_if<Person WorkOrder::*>(&field)) {
+                    frames.push_back({Kind::Person, &(workOrder(top).**member)});
+                } else if (auto member = std::get_if<MoneyValue WorkOrder::*>(&field)) {
+                    frames.push_back({Kind::Money, &(workOrder(top).**member)});
+                } else if (auto member = std::get_if<Margin WorkOrder::*>(&field)) {
+                    frames.push_back({Kind::Margin, &(workOrder(top).**member)});
+                } else {
+                    frames.push_back({Kind::Skip, nullptr});
+                }
+                return;
+            case Kind::PersonList: {
+                auto* list = static_cast<ArenaVector<Person>*>(top.target);
+                list->emplace_back();
+                frames.push_back({Kind::Person, &list->back()});
+                return;
+            }
+            case Kind::CustomFieldList: {
+                auto* list = static_cast<ArenaVector<CustomField>*>(top.target);
+                list->emplace_back();
+                frames.push_back({Kind::CustomField, &list->back()});
+                return;
+            }
+            case Kind::FinishList: {
+                auto* list = static_cast<ArenaVector<Finish>*>(top.target);
+                list->emplace_back();
+                frames.push_back({Kind::Finish, &list->back()});
+                return;
+            }
+            case Kind::Margin:
+                if (subKey == "Cash") {
+                    frames.push_back({Kind::Money, &static_cast<Margin*>(top.target)->Cash});
+                    return;
+                }
+                break;
+            default:
+                break;
+        }
+        frames.push_back({Kind::Skip, nullptr});
+    }
+
+    void startArray() override {
+        if (frames.empty()) {
+            frames.push_back({Kind::Items, nullptr});
+            return;
+        }
+
+        Frame& top = frames.back();
+        if (top.kind == Kind::Root && subKey == "Items") {
+            frames.push_back({Kind::Items, nullptr});
+        } else if (top.kind == Kind::WorkOrder) {
+            WorkOrder& order = workOrder(top);
+            if (auto member = std::get_if<ArenaVector<Person> WorkOrder::*>(&field)) {
+                frames.push_back({Kind::PersonList, list(order.**member)});
+            } else if (auto member = std::get_if<ArenaVector<std::string_view> WorkOrder::*>(&field)) {
+                frames.push_back({Kind::StringList, list(order.**member)});
+            } else if (auto member = std::get_if<ArenaVector<CustomField> WorkOrder::*>(&field)) {
+                frames.push_back({Kind::CustomFieldList, list(order.**member)});
+            } else if (auto member = std::get_if<ArenaVector<Finish> WorkOrder::*>(&field)) {
+                frames.push_back({Kind::FinishList, list(order.**member)});
+            } else {
+                frames.push_back({Kind::Skip, nullptr});
+            }
+        } else {
+            frames.push_back({Kind::Skip, nullptr});
+        }
+    }
+
+    void endObject() override {
+        frames.pop_back();
+        clearKey();
+    }
+
+    void endArray() override {
+        frames.pop_back();
+        clearKey();
+    }
+
+    void key(std::string_view name) override {
+        Frame& top = frames.back();
+        if (top.kind == Kind::WorkOrder) {
+            auto it = workOrderFields().find(name);
+            field = it != workOrderFields().end() ? it->second : WorkOrderMember();
+            knownField = it != workOrderFields().end();
+        } else if (top.kind != Kind::Skip) {
+            subKey.assign(name.data(), name.size());
+        }
+    }
+
+    void string(std::string_view value) override {
+        Frame& top = frames.back();
+        switch (top.kind) {
+            case Kind::WorkOrder:
+                if (!knownField) break;
+                if (auto member = std::get_if<std::string_view WorkOrder::*>(&field)) {
+                    workOrder(top).**member = view(value);
+                } else if (auto member = std::get_if<InternedString WorkOrder::*>(&field)) {
+                    workOrder(top).**member = intern(value);
+                } else if (auto member = std::get_if<int WorkOrder::*>(&field)) {
+                    workOrder(top).**member = parseInt(value);
+                }
+                break;
+            case Kind::StringList:
+                static_cast<ArenaVector<std::string_view>*>(top.target)->push_back(view(value));
+                break;
+            case Kind::Person: {
+                auto* person = static_cast<Person*>(top.target);
+                if (subKey == "Id") person->Id = intern(value);
+                else if (subKey == "FullName") person->FullName = intern(value);
+                break;
+            }
+            case Kind::Money:
+                if (subKey == "CurrencyCode") {
+                    static_cast<MoneyValue*>(top.target)->CurrencyCode = intern(value);
+                }
+                break;
+            case Kind::CustomField: {
+                auto* custom = static_cast<CustomField*>(top.target);
+                if (subKey == "Name") custom->Name = view(value);
+                else if (subKey == "Value") custom->Value = view(value);
+                break;
+            }
+            case Kind::Finish: {
+                auto* finish = static_cast<Finish*>(top.target);
+                if (subKey == "Id") finish->Id = view(value);
+                else if (subKey == "Name") finish->Name = view(value);
+                else if (subKey == "Code") finish->Code = view(value);
+                else if (subKey == "Number") finish->Number = view(value);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void number(std::string_view text) override {
+        Frame& top = frames.back();
+        switch (top.kind) {
+            case Kind::WorkOrder:
+                if (!knownField) break;
+                if (auto member = std::get_if<int WorkOrder::*>(&field)) {
+                    workOrder(top).**member = parseInt(text);
+                } else if (auto member = std::get_if<std::string_view WorkOrder::*>(&field)) {
+                    workOrder(top).**member = view(text);
+                } else if (auto member = std::get_if<InternedString WorkOrder::*>(&field)) {
+                    workOrder(top).**member = intern(text);
+                }
+                break;
+            case Kind::Money: {
+                auto* money = static_cast<MoneyValue*>(top.target);
+                if (subKey == "Value") money->Value = parseDouble(text);
+                else if (subKey == "OriginalValue") money->OriginalValue = parseDouble(text);
+                break;
+            }
+            case Kind::Margin:
+                if (subKey == "Percentage") {
+                    static_cast<Margin*>(top.target)->Percentage = parseDouble(text);
+                }
+                break;
+            case Kind::CustomField:
+                if (subKey == "Type") {
+                    static_cast<CustomField*>(top.target)->Type = parseInt(text);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    void boolean(bool value) override {
+        Frame& top = frames.back();
+        if (top.kind == Kind::WorkOrder && knownField) {
+            if (auto member = std::get_if<bool WorkOrder::*>(&field)) {
+                workOrder(top).**member = value;
+            }
+        }
+    }
+
+    static int parseInt(std::string_view text) {
+        int value = 0;
+        std::from_chars(text.data(), text.data() + text.size(), value);
+        return value;
+    }
+
+    static double parseDouble(std::string_view text) {
+        double value = 0;
+        std::from_chars(text.data(), text.data() + text.size(), value);
+        return value;
+    }
+
+private:
+    enum class Kind {
+        Root,
+        Items,
+        WorkOrder,
+        Person,
+        PersonList,
+        Money,
+        Margin,
+        StringList,
+        CustomField,
+        CustomFieldList,
+        Finish,
+        FinishList,
+        Skip
+    };
+
+    struct Frame {
+        Kind kind;
+        void* target;
+    };
+
+    static WorkOrder& workOrder(Frame& frame) {
+        return *static_cast<WorkOrder*>(frame.target);
+    }
+
+    /**
+     * view - value itself if it points into source, else its copy in the
+     * arena.
+     */
+    std::string_view view(std::string_view value) {
+        std::less_equal<const char*> notAfter;
+        if (notAfter(source.data(), value.data()) &&
+            notAfter(value.data() + value.size(), source.data() + source.size())) {
+            return value;
+        }
+        return arena.copy(value);
+    }
+
+    /**
+     * intern - value as an InternedString of the batch.
+     */
+    InternedString intern(std::string_view value) {
+        return strings.intern(value);
+    }
+
+    /**
+     * list - Points an empty list at the arena before it is filled.
+     */
+    template <typename T>
+    void* list(ArenaVector<T>& target) {
+        target = ArenaVector<T>(ArenaAllocator<T>(&arena));
+        return &target;
+    }
+
+    void clearKey() {
+        knownField = false;
+        subKey.clear();
+    }
+
+    std::vector<WorkOrder>& items;
+    Arena& arena;
+    InternTable& strings;
+    std::string_view source;
+    std::vector<Frame> frames;
+    WorkOrderMember field;
+    bool knownField = false;
+    std::string subKey;
+};
+
+/**
+ * decodeWorkOrdersBorrowed - Decodes a complete API response in one call
+ * without taking ownership of it. The work orders point into json, which
+ * must outlive the batch.
+ */
+inline WorkOrderBatch decodeWorkOrdersBorrowed(std::string_view json) {
+    WorkOrderBatch batch;
+    WorkOrderDecoder decoder(batch, json);
+    JsonStreamParser parser(decoder);
+    parser.feed(json);
+    parser.finish();
+    return batch;
+}
+
+/**
+ * decodeWorkOrders - Decodes a shared response; the batch keeps it alive.
+ */
+inline WorkOrderBatch decodeWorkOrders(std::shared_ptr<const std::string> response) {
+    WorkOrderBatch batch = decodeWorkOrdersBorrowed(*response);
+    batch.response = std::move(response);
+    return batch;
+}
+
+// A temporary would be gone before the batch is used
+WorkOrderBatch decodeWorkOrders(std::string&& json) = delete;
+
+/**
+ * WorkOrderJson - Writes decoded work orders back out as compact JSON.
+ *
+ * Field names and nesting match the Go example's output, so the --typed
+ * output of both tools can be compared directly.
+ */
+class WorkOrderJson {
+public:
+    static void append(std::string& out, const std::vector<WorkOrder>& items) {
+        out += '[';
+        for (size_t i = 0; i < items.size(); i++) {
+            if (i > 0) out += ',';
+            append(out, items[i]);
+        }
+        out += ']';
+    }
+
+    static void append(std::string& out, const WorkOrder& w) {
+        out += '{';
+        field(out, "Id", w.Id, true);
+        field(out, "Number", w.Number);
+        field(out, "Name", w.Name);
+        field(out, "Type", w.Type);
+        field(out, "CreatedBy", w.CreatedBy);
+        field(out, "CreatedOn", w.CreatedOn);
+        field(out, "Facility", w.Facility);
+        field(out, "Outsourced", w.Outsourced);
+        field(out, "Tags", w.Tags);
+        field(out, "Status", w.Status);
+        field(out, "MaterialOnHandDays", w.MaterialOnHandDays);
+        field(out, "Step", w.Step);
+        field(out, "StepIndex", w.StepIndex);
+        field(out, "StepType", w.StepType);
+        field(out, "InvoiceStatus", w.InvoiceStatus);
+        field(out, "Owner", w.Owner);
+        field(out, "Assignees", w.Assignees);
+        field(out, "Drafters", w.Drafters);
+        field(out, "Engineers", w.Engineers);
+        field(out, "Estimators", w.Estimators);
+        field(out, "SalesPersons", w.SalesPersons);
+        field(out, "Coordinators", w.Coordinators);
+        field(out, "Installers", w.Installers);
+        field(out, "ProjectManager", w.ProjectManager);
+        field(out, "PlannedStartDate", w.PlannedStartDate);
+        field(out, "ActualStartDate", w.ActualStartDate);
+        field(out, "PlannedCriticalDate", w.PlannedCriticalDate);
+        field(out, "MaterialNeededDate", w.MaterialNeededDate);
+        field(out, "PlannedEndMonth", w.PlannedEndMonth);
+        field(out, "ActualEndDate", w.ActualEndDate);
+        field(out, "ActualEndMonth", w.ActualEndMonth);
+        field(out, "Instructions", w.Instructions);
+        field(out, "EstimatedLaborCost", w.EstimatedLaborCost);
+        field(out, "EstimatedMaterialCost", w.EstimatedMaterialCost);
+        field(out, "EstimatedCost", w.EstimatedCost);
+        field(out, "EstimatedHours", w.EstimatedHours);
+        field(out, "EstimatedMargin", w.EstimatedMargin);
+        field(out, "RemainingHours", w.RemainingHours);
+        field(out, "PlannedHours", w.PlannedHours);
+        field(out, "PlannedLaborCost", w.PlannedLaborCost);
+        field(out, "LaborGrandTotalPrice", w.LaborGrandTotalPrice);
+        field(out, "ActualLaborHours", w.ActualLaborHours);
+        field(out, "ActualCost", w.ActualCost);
+        field(out, "ActualMaterialCost", w.ActualMaterialCost);
+        field(out, "ActualLaborCost", w.ActualLaborCost);
+        field(out, "ActualExpensesCost", w.ActualExpensesCost);
+        field(out, "ActualMargin", w.ActualMargin);
+        field(out, "MarginVariance", w.MarginVariance);
+        field(out, "GrandTotalPrice", w.GrandTotalPrice);
+        field(out, "PreSalesTaxPrice", w.PreSalesTaxPrice);
+        field(out, "SalesTax", w.SalesTax);
+        field(out, "ExternalIdentifier", w.ExternalIdentifier);
+        field(out, "WorkflowName", w.WorkflowName);
+        field(out, "ProjectNumber", w.ProjectNumber);
+        field(out, "ProjectName", w.ProjectName);
+        field(out, "CustomFields", w.CustomFields);
+        field(out, "Finishes", w.Finishes);
+        out += '}';
+    }
+
+private:
+    static void name(std::string& out, const char* key, bool first) {
+        if (!first) out += ',';
+        out += '"';
+        out += key;
+        out += "\":";
+    }
+
+    static void value(std::string& out, std::string_view s) {
+        out += '"';
+        JsonWriter::escapeTo(out, s);
+        out += '"';
+    }
+
+    static void value(std::string& out, InternedString s) {
+        value(out, s.view());
+    }
+
+    static void value(std::string& out, bool b) {
+        out += b ? "true" : "false";
+    }
+
+    static void value(std::string& out, int n) {
+        out += std::to_string(n);
+    }
+
+    static void value(std::string& out, double d) {
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), d);
+        out.append(buffer, result.ptr);
+    }
+
+    static void value(std::string& out, const Person& p) {
+        out += '{';
+        field(out, "Id", p.Id, true);
+        field(out, "FullName", p.FullName);
+        out += '}';
+    }
+
+    static void value(std::string& out, const MoneyValue& m) {
+        out += '{';
+        field(out, "Value", m.Value, true);
+        field(out, "OriginalValue", m.OriginalValue);
+        field(out, "CurrencyCode", m.CurrencyCode);
+        out += '}';
+    }
+
+    static void value(std::string& out, const Margin& m) {
+        out += '{';
+        field(out, "Cash", m.Cash, true);
+        field(out, "Percentage", m.Percentage);
+        out += '}';
+    }
+
+    static void value(std::string& out, const CustomField& c) {
+        out += '{';
+        field(out, "Name", c.Name, true);
+        field(out, "Type", c.Type);
+        field(out, "Value", c.Value);
+        out += '}';
+    }
+
+    static void value(std::string& out, const Finish& f) {
+        out += '{';
+        field(out, "Id", f.Id, true);
+        field(out, "Name", f.Name);
+        field(out, "Code", f.Code);
+        field(out, "Number", f.Number);
+        out += '}';
+    }
+
+    template <typename T, typename Allocator>
+    static void value(std::string& out, const std::vector<T, Allocator>& list) {
+        out += '[';
+        for (size_t i = 0; i < list.size(); i++) {
+            if (i > 0) out += ',';
+            value(out, list[i]);
+        }
+        out += ']';
+    }
+
+    template <typename T>
+    static void field(std::string& out, const char* key, const T& v, bool first = false) {
+        name(out, key, first);
+        value(out, v);
+    }
+};
+
+#endif
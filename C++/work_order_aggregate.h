@@ -0,0 +1,476 @@
+/**
+ * Work Order Aggregates
+ *
+ * Totals of the money fields of decoded work orders per facility, status,
+ * month and the like, computed over WorkOrderColumns so reports don't have
+ * to post-process the raw output.
+ *
+ *   1. Every row gets a group code from the grouping column: its dictionary
+ *      code, or for the month groupings a dense code per distinct month
+ *   2. A money field is only added up within one currency, so the key of
+ *      a row is (group, CurrencyCode of that field). Fields of the same row
+ *      can have different currencies and are keyed separately
+ *   3. A counting sort on the key gathers the values of every key into one
+ *      contiguous run
+ *   4. Each run is reduced to count, sum, min and max by a SIMD kernel;
+ *      avg is sum / count
+ *
+ * The kernels are picked at runtime with __builtin_cpu_supports: AVX2
+ * when the CPU has it, SSE2 on any other x86-64 CPU and a scalar loop
+ * everywhere else. The values are summed in several lanes, so a sum can
+ * differ from a strictly left-to-right one in the last bits.
+ *
+ * Header only, include it from work_orders.cpp.
+ */
+
+#ifndef WORK_ORDER_AGGREGATE_H
+#define WORK_ORDER_AGGREGATE_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "json_writer.h"
+#include "work_order_columns.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define WORK_ORDER_AGGREGATE_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * AggregateStats - The count, sum, min and max of the values of one
+ * group, currency and field. min and max are 0 for an empty one.
+ */
+struct AggregateStats {
+    size_t count = 0;
+    double sum = 0;
+    double min = 0;
+    double max = 0;
+
+    double avg() const {
+        return count == 0 ? 0 : sum / static_cast<double>(count);
+    }
+};
+
+namespace work_order_aggregate_detail {
+
+inline void reduceScalar(const double* values, size_t count, AggregateStats& stats) {
+    double lanes[4] = {0, 0, 0, 0};
+    double low = std::numeric_limits<double>::infinity();
+    double high = -std::numeric_limits<double>::infinity();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        for (size_t lane = 0; lane < 4; lane++) {
+            lanes[lane] += values[i + lane];
+            low = std::min(low, values[i + lane]);
+            high = std::max(high, values[i + lane]);
+        }
+    }
+    for (; i < count; i++) {
+        lanes[0] += values[i];
+        low = std::min(low, values[i]);
+        high = std::max(high, values[i]);
+    }
+    stats.sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    stats.min = low;
+    stats.max = high;
+}
+
+#ifdef WORK_ORDER_AGGREGATE_X86
+__attribute__((target("sse2")))
+inline void reduceSse2(const double* values, size_t count, AggregateStats& stats) {
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d sum1 = _mm_setzero_pd();
+    __m128d low = _mm_set1_pd(std::numeric_limits<double>::infinity());
+    __m128d high = _mm_set1_pd(-std::numeric_limits<double>::infinity());
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128d a = _mm_loadu_pd(values + i);
+        __m128d b = _mm_loadu_pd(values + i + 2);
+        sum0 = _mm_add_pd(sum0, a);
+        sum1 = _mm_add_pd(sum1, b);
+        low = _mm_min_pd(low, _mm_min_pd(a, b));
+        high = _mm_max_pd(high, _mm_max_pd(a, b));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+    double sum = lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, low);
+    double lowest = std::min(lanes[0], lanes[1]);
+    _mm_storeu_pd(lanes, high);
+    double highest = std::max(lanes[0], lanes[1]);
+    for (; i < count; i++) {
+        sum += values[i];
+        lowest = std::min(lowest, values[i]);
+        highest = std::max(highest, values[i]);
+    }
+    stats.sum = sum;
+    stats.min = lowest;
+    stats.max = highest;
+}
+
+__attribute__((target("avx2")))
+inline void reduceAvx2(const double* values, size_t count, AggregateStats& stats) {
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    __m256d low = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+    __m256d high = _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256d a = _mm256_loadu_pd(values + i);
+        __m256d b = _mm256_loadu_pd(values + i + 4);
+        sum0 = _mm256_add_pd(sum0, a);
+        sum1 = _mm256_add_pd(sum1, b);
+        low = _mm256_min_pd(low, _mm256_min_pd(a, b));
+        high = _mm256_max_pd(high, _mm256_max_pd(a, b));
+    }
+
+    __m256d sum = _mm256_add_pd(sum0, sum1);
+    __m128d sum2 = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+    __m128d low2 = _mm_min_pd(_mm256_castpd256_pd128(low), _mm256_extractf128_pd(low, 1));
+    __m128d high2 = _mm_max_pd(_mm256_castpd256_pd128(high), _mm256_extractf128_pd(high, 1));
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, sum2);
+    double total = lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, low2);
+    double lowest = std::min(lanes[0], lanes[1]);
+    _mm_storeu_pd(lanes, high2);
+    double highest = std::max(lanes[0], lanes[1]);
+    for (; i < count; i++) {
+        total += values[i];
+        lowest = std::min(lowest, values[i]);
+        highest = std::max(highest, values[i]);
+    }
+    stats.sum = total;
+    stats.min = lowest;
+    stats.max = highest;
+}
+#endif
+
+using ReduceFunction = void (*)(const double*, size_t, AggregateStats&);
+
+/**
+ * selectReduceFunction - Picks the fastest implementation this CPU runs.
+ */
+inline ReduceFunction selectReduceFunction() {
+#ifdef WORK_ORDER_AGGREGATE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return reduceAvx2;
+    }
+    return reduceSse2;
+#else
+    return reduceScalar;
+#endif
+}
+
+/**
+ * appendMoney - Appends an amount with two decimals, like the API shows it.
+ */
+inline void appendMoney(std::string& out, double value) {
+    char buffer[64];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, 2);
+    out.append(buffer, result.ptr);
+}
+
+}
+
+/**
+ * reduceValues - The count, sum, min and max of values[0..count).
+ */
+inline AggregateStats reduceValues(const double* values, size_t count) {
+    static const work_order_aggregate_detail::ReduceFunction reduce =
+        work_order_aggregate_detail::selectReduceFunction();
+
+    AggregateStats stats;
+    stats.count = count;
+    if (count > 0) reduce(values, count, stats);
+    return stats;
+}
+
+/**
+ * AggregateResult - The stats of every measure per group and currency.
+ *
+ * stats[m][group * currencies.size() + currency] belongs to measures[m];
+ * keys with no values have a count of 0.
+ */
+struct AggregateResult {
+    std::string groupBy;
+    std::vector<std::string> groups;
+    std::vector<std::string> currencies;
+    std::vector<std::string> measures;
+    std::vector<std::vector<AggregateStats>> stats;
+
+    /**
+     * toJson - The result as {"groupBy":..., "groups":[...]}, one entry
+     * per group and currency that has any values, ordered by group and
+     * then currency name. Each entry has the group, the CurrencyCode and
+     * per measure its count, sum, min, max and avg.
+     */
+    std::string toJson() const {
+        std::vector<uint32_t> groupOrder = sortedCodes(groups);
+        std::vector<uint32_t> currencyOrder = sortedCodes(currencies);
+
+        std::string out = "{\"groupBy\":\"";
+        JsonWriter::escapeTo(out, groupBy);
+        out += "\",\"groups\":[";
+        bool first = true;
+        for (uint32_t group : groupOrder) {
+            for (uint32_t currency : currencyOrder) {
+                size_t key = group * currencies.size() + currency;
+                bool any = false;
+                for (const auto& measure : stats) any = any || measure[key].count > 0;
+                if (!any) continue;
+
+                if (!first) out += ',';
+                first = false;
+                out += "{\"";
+                JsonWriter::escapeTo(out, groupBy);
+                out += "\":\"";
+                JsonWriter::escapeTo(out, groups[group]);
+                out += "\",\"CurrencyCode\":\"";
+                JsonWriter::escapeTo(out, currencies[currency]);
+                out += '"';
+                for (size_t m = 0; m < measures.size(); m++) {
+                    const AggregateStats& s = stats[m][key];
+                    out += ",\"";
+                    JsonWriter::escapeTo(out, measures[m]);
+                    out += "\":{\"count\":";
+                    out += std::to_string(s.count);
+                    out += ",\"sum\":";
+                    work_order_aggregate_detail::appendMoney(out, s.sum);
+                    out += ",\"min\":";
+                    work_order_aggregate_detail::appendMoney(out, s.min);
+                    out += ",\"max\":";
+                    work_order_aggregate_detail::appendMoney(out, s.max);
+                    out += ",\"avg\":";
+                    work_order_aggregate_detail::appendMoney(out, s.avg());
+                    out += '}';
+                }
+                out += '}';
+            }
+        }
+        out += "]}";
+        return out;
+    }
+
+private:
+    static std::vector<uint32_t> sortedCodes(const std::vector<std::string>& names) {
+        std::vector<uint32_t> order(names.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = static_cast<uint32_t>(i);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return names[a] < names[b]; });
+        return order;
+    }
+};
+
+/**
+ * WorkOrderAggregator - Groups the rows of a WorkOrderColumns and
+ * aggregates money fields per group and currency. It only keeps a
+ * reference to the columns, which must outlive it.
+ */
+class WorkOrderAggregator {
+public:
+    explicit WorkOrderAggregator(const WorkOrderColumns& columns) : columns(columns) {}
+
+    /**
+     * defaultMeasures - The fields reports total when none are given.
+     */
+    static std::vector<std::string> defaultMeasures() {
+        return {"EstimatedCost", "ActualCost", "GrandTotalPrice", "SalesTax",
+                "MarginVariance", "EstimatedMargin", "ActualMargin"};
+    }
+
+    /**
+     * checkGroupBy / checkMeasure - Throw for a name that can't be used,
+     * so options can be checked before anything is fetched.
+     */
+    static void checkGroupBy(std::string_view name) {
+        WorkOrderColumns empty;
+        if (!WorkOrderAggregator(empty).grouping(name, nullptr)) {
+            throw std::runtime_error("Can't aggregate by " + std::string(name) +
+                                     ", only by Facility, Status, Step, StepType, Type, InvoiceStatus, WorkflowName, "
+                                     "ProjectNumber, CreatedMonth, PlannedEndMonth and ActualEndMonth");
+        }
+    }
+
+    static void checkMeasure(std::string_view name) {
+        WorkOrderColumns empty;
+        if (!WorkOrderAggregator(empty).measure(name)) {
+            throw std::runtime_error("Can't aggregate " + std::string(name) + ", it isn't a money field");
+        }
+    }
+
+    /**
+     * aggregate - The stats of measures (money field names; a margin stands
+     * for its cash amount) per value of groupBy and per currency.
+     *
+     *   1. Every row gets its group code
+     *   2. Per measure the key of a row is group * currencies + currency
+     *   3. A counting sort on the keys lays out the values key by key; a
+     *      measure whose keys are the same as the previous one's (the
+     *      usual case, one currency per work order) reuses its layout
+     *   4. The run of every key is reduced with reduceValues
+     */
+    AggregateResult aggregate(std::string_view groupBy, const std::vector<std::string>& measures) const {
+        AggregateResult result;
+        result.groupBy = std::string(groupBy);
+        result.measures = measures;
+
+        std::vector<uint32_t> groups;
+        if (!grouping(groupBy, &result.groups, &groups)) checkGroupBy(groupBy);
+        for (size_t c = 0; c < columns.currencies.size(); c++) {
+            result.currencies.push_back(columns.currencies[static_cast<uint32_t>(c)]);
+        }
+
+        size_t rows = columns.size();
+        size_t currencyCount = result.currencies.size();
+        size_t keyCount = result.groups.size() * currencyCount;
+
+        std::vector<uint32_t> keys(rows);
+        std::vector<uint32_t> previousKeys;
+        std::vector<size_t> offsets;
+        std::vector<uint32_t> order(rows);
+        std::vector<double> gathered(rows);
+
+        for (const std::string& name : measures) {
+            const MoneyColumn* column = measure(name);
+            if (!column) checkMeasure(name);
+
+            const uint32_t* currency = column->CurrencyCode.data();
+            for (size_t row = 0; row < rows; row++) {
+                keys[row] = groups[row] * static_cast<uint32_t>(currencyCount) + currency[row];
+            }
+
+            if (keys != previousKeys) {
+                offsets.assign(keyCount + 1, 0);
+                for (uint32_t key : keys) offsets[key + 1]++;
+                for (size_t key = 0; key < keyCount; key++) offsets[key + 1] += offsets[key];
+                std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+                for (size_t row = 0; row < rows; row++) order[next[keys[row]]++] = static_cast<uint32_t>(row);
+                previousKeys.swap(keys);
+                keys.resize(rows);
+            }
+
+            const double* values = column->Value.data();
+            for (size_t i = 0; i < rows; i++) gathered[i] = values[order[i]];
+
+            std::vector<AggregateStats>& stats = result.stats.emplace_back(keyCount);
+            for (size_t key = 0; key < keyCount; key++) {
+                stats[key] = reduceValues(gathered.data() + offsets[key], offsets[key + 1] - offsets[key]);
+            }
+        }
+        return result;
+    }
+
+private:
+    /**
+     * grouping - The group names and the group code of every row for
+     * groupBy. Months are named YYYY-MM and rows without a date are in
+     * the group "". Returns false for an unknown groupBy.
+     */
+    bool grouping(std::string_view groupBy, std::vector<std::string>* names,
+                  std::vector<uint32_t>* codes = nullptr) const {
+        struct DictionaryGrouping {
+            const char* name;
+            const DictionaryColumn WorkOrderColumns::*column;
+        };
+        static const DictionaryGrouping dictionaries[] = {
+            {"Facility", &WorkOrderColumns::Facility}, {"Status", &WorkOrderColumns::Status},
+            {"Step", &WorkOrderColumns::Step}, {"StepType", &WorkOrderColumns::StepType},
+            {"Type", &WorkOrderColumns::Type}, {"InvoiceStatus", &WorkOrderColumns::InvoiceStatus},
+            {"WorkflowName", &WorkOrderColumns::WorkflowName}, {"ProjectNumber", &WorkOrderColumns::ProjectNumber},
+        };
+        struct MonthGrouping {
+            const char* name;
+            const std::vector<int32_t> WorkOrderColumns::*column;
+        };
+        static const MonthGrouping months[] = {
+            {"CreatedMonth", &WorkOrderColumns::CreatedOn},
+            {"PlannedEndMonth", &WorkOrderColumns::PlannedEndMonth},
+            {"ActualEndMonth", &WorkOrderColumns::ActualEndMonth},
+        };
+
+        for (const DictionaryGrouping& g : dictionaries) {
+            if (groupBy != g.name) continue;
+            if (!names) return true;
+            const DictionaryColumn& column = columns.*g.column;
+            for (size_t c = 0; c < column.dictionary.size(); c++) {
+                names->push_back(column.dictionary[static_cast<uint32_t>(c)]);
+            }
+            *codes = column.codes;
+            return true;
+        }
+
+        for (const MonthGrouping& g : months) {
+            if (groupBy != g.name) continue;
+            if (!names) return true;
+            const std::vector<int32_t>& days = columns.*g.column;
+            std::unordered_map<int32_t, uint32_t> monthCodes;
+            codes->reserve(days.size());
+            for (int32_t day : days) {
+                int32_t month = NO_DATE;
+                int year = 0;
+                unsigned m = 0, d = 0;
+                if (day != NO_DATE) {
+                    civilFromDays(day, year, m, d);
+                    month = year * 12 + static_cast<int32_t>(m) - 1;
+                }
+                auto [it, added] = monthCodes.emplace(month, static_cast<uint32_t>(names->size()));
+                if (added) {
+                    // Room for any int year and unsigned month, so the label is never cut
+                    char label[32] = "";
+                    if (day != NO_DATE) std::snprintf(label, sizeof(label), "%04d-%02u", year, m);
+                    names->push_back(label);
+                }
+                codes->push_back(it->second);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * measure - The money column of a field name, nullptr if there is none.
+     */
+    const MoneyColumn* measure(std::string_view name) const {
+        struct Measure {
+            const char* name;
+            const MoneyColumn WorkOrderColumns::*column;
+        };
+        static const Measure money[] = {
+            {"EstimatedLaborCost", &WorkOrderColumns::EstimatedLaborCost},
+            {"EstimatedMaterialCost", &WorkOrderColumns::EstimatedMaterialCost},
+            {"EstimatedCost", &WorkOrderColumns::EstimatedCost},
+            {"PlannedLaborCost", &WorkOrderColumns::PlannedLaborCost},
+            {"LaborGrandTotalPrice", &WorkOrderColumns::LaborGrandTotalPrice},
+            {"ActualCost", &WorkOrderColumns::ActualCost},
+            {"ActualMaterialCost", &WorkOrderColumns::ActualMaterialCost},
+            {"ActualLaborCost", &WorkOrderColumns::ActualLaborCost},
+            {"ActualExpensesCost", &WorkOrderColumns::ActualExpensesCost},
+            {"MarginVariance", &WorkOrderColumns::MarginVariance},
+            {"GrandTotalPrice", &WorkOrderColumns::GrandTotalPrice},
+            {"PreSalesTaxPrice", &WorkOrderColumns::PreSalesTaxPrice},
+            {"SalesTax", &WorkOrderColumns::SalesTax},
+        };
+        for (const Measure& m : money) {
+            if (name == m.name) return &(columns.*m.column);
+        }
+        if (name == "EstimatedMargin") return &columns.EstimatedMargin.Cash;
+        if (name == "ActualMargin") return &columns.ActualMargin.Cash;
+        return nullptr;
+    }
+
+    const WorkOrderColumns& columns;
+};
+
+#endif
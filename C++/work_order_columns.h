@@ -0,0 +1,408 @@
+/**
+ * Work Order Columns
+ *
+ * Decoded work orders in a structure-of-arrays layout. A WorkOrder is
+ * about 70 fields and well over a kilobyte with its strings and people
+ * lists, so summing one cost over a vector of them pulls a cache line per
+ * order for 8 useful bytes. Here every field is its own contiguous array
+ * and a report only reads the columns it uses.
+ *
+ *   1. Money amounts are double columns, one per MoneyValue (Value and
+ *      OriginalValue), with the CurrencyCode as a code into one shared
+ *      currency dictionary
+ *   2. StepIndex and MaterialOnHandDays are int32 columns, Outsourced a
+ *      uint8 column
+ *   3. Low-cardinality strings (Status, Facility, Step, ...) are
+ *      dictionary encoded: a uint32 code per row and each distinct value
+ *      stored once
+ *   4. Dates are int32 days since 1970-01-01 (NO_DATE if empty), months
+ *      the day of their first; hours are doubles (NaN if empty)
+ *
+ * Header only, include it from work_orders.cpp.
+ */
+
+#ifndef WORK_ORDER_COLUMNS_H
+#define WORK_ORDER_COLUMNS_H
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "work_order.h"
+
+/**
+ * NO_DATE - The epoch day of an empty or unparseable date.
+ */
+constexpr int32_t NO_DATE = std::numeric_limits<int32_t>::min();
+
+/**
+ * daysFromCivil - Days since 1970-01-01 of a proleptic Gregorian date,
+ * negative before it. Exact for every int32 day, without a time zone or
+ * a table.
+ */
+constexpr int32_t daysFromCivil(int year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+    unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<int32_t>(dayOfEra) - 719468;
+}
+
+/**
+ * civilFromDays - The inverse of daysFromCivil.
+ */
+constexpr void civilFromDays(int32_t days, int& year, unsigned& month, unsigned& day) {
+    int z = days + 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned dayOfEra = static_cast<unsigned>(z - era * 146097);
+    unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    unsigned mp = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int>(yearOfEra) + era * 400 + (month <= 2);
+}
+
+/**
+ * daysInMonth - The number of days of month (1-12) in a proleptic
+ * Gregorian year.
+ */
+constexpr unsigned daysInMonth(int year, unsigned month) {
+    if (month != 2) return month == 4 || month == 6 || month == 9 || month == 11 ? 30 : 31;
+    bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    return leap ? 29 : 28;
+}
+
+/**
+ * parseEpochDay - The epoch day of "YYYY-MM-DD", optionally followed by a
+ * time ("2024-03-05T10:30:00"), or of the first of "YYYY-MM". NO_DATE for
+ * anything else, including "" and days the month doesn't have
+ * ("2024-02-30").
+ */
+inline int32_t parseEpochDay(std::string_view text) {
+    auto number = [&](size_t pos, size_t length, unsigned& out) {
+        if (text.size() < pos + length) return false;
+        auto [end, ec] = std::from_chars(text.data() + pos, text.data() + pos + length, out);
+        return ec == std::errc() && end == text.data() + pos + length;
+    };
+
+    unsigned year, month, day = 1;
+    if (!number(0, 4, year) || text.size() < 7 || text[4] != '-' || !number(5, 2, month)) return NO_DATE;
+    if (text.size() > 7 && (text[7] != '-' || !number(8, 2, day) || (text.size() > 10 && text[10] != 'T'))) {
+        return NO_DATE;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > daysInMonth(static_cast<int>(year), month)) return NO_DATE;
+    return daysFromCivil(static_cast<int>(year), month, day);
+}
+
+/**
+ * parseHours - An hours field, which the API sends as text ("12.5"). NaN
+ * if it is empty or not a number, so sums can skip it.
+ */
+inline double parseHours(std::string_view text) {
+    double value = 0;
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (text.empty() || ec != std::errc() || end != text.data() + text.size()) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return value;
+}
+
+/**
+ * StringDictionary - Each distinct string once, numbered in order of
+ * first appearance. values is a deque so the string_view keys of lookup
+ * stay valid while it grows. InternedStrings are translated through
+ * byId, their intern table id to code, so only their first occurrence is
+ * hashed; ids are per batch, so they must all come from one batch.
+ */
+class StringDictionary {
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    StringDictionary() = default;
+
+    // The lookup keys point into values
+    StringDictionary(const StringDictionary& other) {
+        for (const std::string& value : other.values) intern(value);
+    }
+
+    StringDictionary& operator=(const StringDictionary& other) {
+        if (this != &other) {
+            values.clear();
+            lookup.clear();
+            byId.clear();
+            for (const std::string& value : other.values) intern(value);
+        }
+        return *this;
+    }
+
+    StringDictionary(StringDictionary&&) = default;
+    StringDictionary& operator=(StringDictionary&&) = default;
+
+    /**
+     * intern - The code of value, adding it if it is new.
+     */
+    uint32_t intern(std::string_view value) {
+        auto it = lookup.find(value);
+        if (it != lookup.end()) return it->second;
+        uint32_t code = static_cast<uint32_t>(values.size());
+        values.emplace_back(value);
+        lookup.emplace(values.back(), code);
+        return code;
+    }
+
+    uint32_t intern(InternedString value) {
+        if (value.id() >= byId.size()) byId.resize(value.id() + 1, NOT_FOUND);
+        uint32_t& code = byId[value.id()];
+        if (code == NOT_FOUND) code = intern(value.view());
+        return code;
+    }
+
+    /**
+     * find - The code of value, or NOT_FOUND.
+     */
+    uint32_t find(std::string_view value) const {
+        auto it = lookup.find(value);
+        return it == lookup.end() ? NOT_FOUND : it->second;
+    }
+
+    const std::string& operator[](uint32_t code) const {
+        return values[code];
+    }
+
+    size_t size() const {
+        return values.size();
+    }
+
+private:
+    std::deque<std::string> values;
+    std::unordered_map<std::string_view, uint32_t> lookup;
+    std::vector<uint32_t> byId;
+};
+
+/**
+ * DictionaryColumn - A string column stored as one code per row.
+ */
+struct DictionaryColumn {
+    StringDictionary dictionary;
+    std::vector<uint32_t> codes;
+
+    void push_back(std::string_view value) {
+        codes.push_back(dictionary.intern(value));
+    }
+
+    void push_back(InternedString value) {
+        codes.push_back(dictionary.intern(value));
+    }
+
+    const std::string& operator[](size_t row) const {
+        return dictionary[codes[row]];
+    }
+};
+
+/**
+ * MoneyColumn - A MoneyValue field: the amounts as doubles and the
+ * currency as a code into WorkOrderColumns::currencies.
+ */
+struct MoneyColumn {
+    std::vector<double> Value;
+    std::vector<double> OriginalValue;
+    std::vector<uint32_t> CurrencyCode;
+};
+
+/**
+ * MarginColumn - A Margin field: its cash amount and its percentage.
+ */
+struct MarginColumn {
+    MoneyColumn Cash;
+    std::vector<double> Percentage;
+};
+
+/**
+ * WorkOrderColumns - The columnar form of a std::vector<WorkOrder>.
+ *
+ * Columns keep the names of the WorkOrder fields they hold. Row i of
+ * every column is the i-th work order. People lists, tags, custom fields
+ * and finishes have no columns; reports use the struct for those. Id and
+ * Number point into the WorkOrderBatch the rows were decoded into, like
+ * the WorkOrder fields, so the batch has to outlive the columns. All rows
+ * come from the same batch, whose intern ids the dictionaries use.
+ */
+struct WorkOrderColumns {
+    std::vector<std::string_view> Id;
+    std::vector<std::string_view> Number;
+    DictionaryColumn Type;
+    DictionaryColumn Facility;
+    DictionaryColumn Status;
+    DictionaryColumn Step;
+    DictionaryColumn StepType;
+    DictionaryColumn InvoiceStatus;
+    DictionaryColumn WorkflowName;
+    DictionaryColumn ProjectNumber;
+    std::vector<uint8_t> Outsourced;
+    std::vector<int32_t> MaterialOnHandDays;
+    std::vector<int32_t> StepIndex;
+
+    std::vector<int32_t> CreatedOn;
+    std::vector<int32_t> PlannedStartDate;
+    std::vector<int32_t> ActualStartDate;
+    std::vector<int32_t> PlannedCriticalDate;
+    std::vector<int32_t> MaterialNeededDate;
+    std::vector<int32_t> PlannedEndMonth;
+    std::vector<int32_t> ActualEndDate;
+    std::vector<int32_t> ActualEndMonth;
+
+    std::vector<double> EstimatedHours;
+    std::vector<double> RemainingHours;
+    std::vector<double> PlannedHours;
+    std::vector<double> ActualLaborHours;
+
+    MoneyColumn EstimatedLaborCost;
+    MoneyColumn EstimatedMaterialCost;
+    MoneyColumn EstimatedCost;
+    MarginColumn EstimatedMargin;
+    MoneyColumn PlannedLaborCost;
+    MoneyColumn LaborGrandTotalPrice;
+    MoneyColumn ActualCost;
+    MoneyColumn ActualMaterialCost;
+    MoneyColumn ActualLaborCost;
+    MoneyColumn ActualExpensesCost;
+    MarginColumn ActualMargin;
+    MoneyColumn MarginVariance;
+    MoneyColumn GrandTotalPrice;
+    MoneyColumn PreSalesTaxPrice;
+    MoneyColumn SalesTax;
+
+    StringDictionary currencies;
+
+    WorkOrderColumns() = default;
+
+    explicit WorkOrderColumns(const std::vector<WorkOrder>& items) {
+        reserve(items.size());
+        for (const WorkOrder& w : items) append(w);
+    }
+
+    size_t size() const {
+        return Id.size();
+    }
+
+    /**
+     * append - Adds one work order as the next row of every column.
+     */
+    void append(const WorkOrder& w) {
+        Id.push_back(w.Id);
+        Number.push_back(w.Number);
+        Type.push_back(w.Type);
+        Facility.push_back(w.Facility);
+        Status.push_back(w.Status);
+        Step.push_back(w.Step);
+        StepType.push_back(w.StepType);
+        InvoiceStatus.push_back(w.InvoiceStatus);
+        WorkflowName.push_back(w.WorkflowName);
+        ProjectNumber.push_back(w.ProjectNumber);
+        Outsourced.push_back(w.Outsourced ? 1 : 0);
+        MaterialOnHandDays.push_back(w.MaterialOnHandDays);
+        StepIndex.push_back(w.StepIndex);
+
+        CreatedOn.push_back(parseEpochDay(w.CreatedOn));
+        PlannedStartDate.push_back(parseEpochDay(w.PlannedStartDate));
+        ActualStartDate.push_back(parseEpochDay(w.ActualStartDate));
+        PlannedCriticalDate.push_back(parseEpochDay(w.PlannedCriticalDate));
+        MaterialNeededDate.push_back(parseEpochDay(w.MaterialNeededDate));
+        PlannedEndMonth.push_back(parseEpochDay(w.PlannedEndMonth));
+        ActualEndDate.push_back(parseEpochDay(w.ActualEndDate));
+        ActualEndMonth.push_back(parseEpochDay(w.ActualEndMonth));
+
+        EstimatedHours.push_back(parseHours(w.EstimatedHours));
+        RemainingHours.push_back(parseHours(w.RemainingHours));
+        PlannedHours.push_back(parseHours(w.PlannedHours));
+        ActualLaborHours.push_back(parseHours(w.ActualLaborHours));
+
+        money(EstimatedLaborCost, w.EstimatedLaborCost);
+        money(EstimatedMaterialCost, w.EstimatedMaterialCost);
+        money(EstimatedCost, w.EstimatedCost);
+        margin(EstimatedMargin, w.EstimatedMargin);
+        money(PlannedLaborCost, w.PlannedLaborCost);
+        money(LaborGrandTotalPrice, w.LaborGrandTotalPrice);
+        money(ActualCost, w.ActualCost);
+        money(ActualMaterialCost, w.ActualMaterialCost);
+        money(ActualLaborCost, w.ActualLaborCost);
+        money(ActualExpensesCost, w.ActualExpensesCost);
+        margin(ActualMargin, w.ActualMargin);
+        money(MarginVariance, w.MarginVariance);
+        money(GrandTotalPrice, w.GrandTotalPrice);
+        money(PreSalesTaxPrice, w.PreSalesTaxPrice);
+        money(SalesTax, w.SalesTax);
+    }
+
+    /**
+     * reserve - Reserves room for rows work orders in every column.
+     */
+    void reserve(size_t rows) {
+        for (auto* column : {&Id, &Number}) column->reserve(rows);
+        for (auto* column : {&Type, &Facility, &Status, &Step, &StepType, &InvoiceStatus, &WorkflowName, &ProjectNumber}) {
+            column->codes.reserve(rows);
+        }
+        Outsourced.reserve(rows);
+        for (auto* column : {&MaterialOnHandDays, &StepIndex, &CreatedOn, &PlannedStartDate, &ActualStartDate,
+                             &PlannedCriticalDate, &MaterialNeededDate, &PlannedEndMonth, &ActualEndDate, &ActualEndMonth}) {
+            column->reserve(rows);
+        }
+        for (auto* column : {&EstimatedHours, &RemainingHours, &PlannedHours, &ActualLaborHours,
+                             &EstimatedMargin.Percentage, &ActualMargin.Percentage}) {
+            column->reserve(rows);
+        }
+        for (MoneyColumn* column : moneyColumns()) {
+            column->Value.reserve(rows);
+            column->OriginalValue.reserve(rows);
+            column->CurrencyCode.reserve(rows);
+        }
+    }
+
+private:
+    std::vector<MoneyColumn*> moneyColumns() {
+        return {&EstimatedLaborCost, &EstimatedMaterialCost, &EstimatedCost, &EstimatedMargin.Cash,
+                &PlannedLaborCost, &LaborGrandTotalPrice, &ActualCost, &ActualMaterialCost,
+                &ActualLaborCost, &ActualExpensesCost, &ActualMargin.Cash, &MarginVariance,
+                &GrandTotalPrice, &PreSalesTaxPrice, &SalesTax};
+    }
+
+    void money(MoneyColumn& column, const MoneyValue& value) {
+        column.Value.push_back(value.Value);
+        column.OriginalValue.push_back(value.OriginalValue);
+        column.CurrencyCode.push_back(currencies.intern(value.CurrencyCode));
+    }
+
+    void margin(MarginColumn& column, const Margin& value) {
+        money(column.Cash, value.Cash);
+        column.Percentage.push_back(value.Percentage);
+    }
+};
+
+/**
+ * columnSum - The sum of values[0..count). Four independent partial sums
+ * break the dependency on one accumulator, so the compiler can keep them
+ * in one vector register and the loop runs at load speed; the result can
+ * differ from a strictly left-to-right sum in the last bits.
+ */
+inline double columnSum(const double* values, size_t count) {
+    double lanes[4] = {0, 0, 0, 0};
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        lanes[0] += values[i];
+        lanes[1] += values[i + 1];
+        lanes[2] += values[i + 2];
+        lanes[3] += values[i + 3];
+    }
+    for (; i < count; i++) lanes[0] += values[i];
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+#endif
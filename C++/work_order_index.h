@@ -0,0 +1,271 @@
+/**
+ * Work Order Index
+ *
+ * Secondary indexes over decoded work orders, built once per fetch, so
+ * slicing by Status, Facility, Step and the like doesn't scan every
+ * record again.
+ *
+ *   1. Every indexed field is dictionary encoded: each distinct value gets
+ *      a dense code, and a column holds the code of every row
+ *   2. Every code has a posting list, the sorted numbers of the rows that
+ *      have it
+ *   3. A query is a list of Field=Value conditions. Conditions on the same
+ *      field are OR'ed, conditions on different fields AND'ed
+ *   4. A query walks the shortest posting list and checks the other
+ *      fields in their code columns, one array lookup per row and field,
+ *      so it costs about as much as the smallest answer it could give
+ *
+ * Header only, include it from work_orders.cpp.
+ */
+
+#ifndef WORK_ORDER_INDEX_H
+#define WORK_ORDER_INDEX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "work_order.h"
+
+/**
+ * IndexedField - The WorkOrder fields WorkOrderIndex can query. StepIndex
+ * is indexed by its decimal text.
+ */
+enum class IndexedField { Status, Facility, Step, StepIndex, WorkflowName, ProjectNumber };
+
+/**
+ * IndexCondition - One Field=Value condition of a query.
+ */
+struct IndexCondition {
+    IndexedField field;
+    std::string value;
+};
+
+class WorkOrderIndex {
+public:
+    static constexpr size_t FIELD_COUNT = 6;
+
+    /**
+     * WorkOrderIndex - Indexes items. Rows are positions in items; the
+     * index doesn't keep a reference to it.
+     */
+    explicit WorkOrderIndex(const std::vector<WorkOrder>& items) : rowCount(items.size()) {
+        if (items.size() > UINT32_MAX) {
+            throw std::runtime_error("Too many work orders to index");
+        }
+
+        std::string scratch;
+        std::vector<uint32_t> byId;
+        for (size_t f = 0; f < FIELD_COUNT; f++) {
+            Column& column = columns[f];
+            column.rows.reserve(items.size());
+            byId.clear();
+            for (size_t row = 0; row < items.size(); row++) {
+                IndexedField field = static_cast<IndexedField>(f);
+                const InternedString* interned = internedOf(items[row], field);
+                uint32_t code;
+                if (interned) {
+                    if (interned->id() >= byId.size()) byId.resize(interned->id() + 1, UINT32_MAX);
+                    code = byId[interned->id()];
+                    if (code == UINT32_MAX) code = byId[interned->id()] = codeOf(column, interned->view());
+                } else {
+                    code = codeOf(column, valueOf(items[row], field, scratch));
+                }
+                column.rows.push_back(code);
+                column.postings[code].push_back(static_cast<uint32_t>(row));
+            }
+        }
+    }
+
+    // The dictionary lookups point into the dictionary itself
+    WorkOrderIndex(const WorkOrderIndex&) = delete;
+    WorkOrderIndex& operator=(const WorkOrderIndex&) = delete;
+
+    static const char* fieldName(IndexedField field) {
+        switch (field) {
+            case IndexedField::Status: return "Status";
+            case IndexedField::Facility: return "Facility";
+            case IndexedField::Step: return "Step";
+            case IndexedField::StepIndex: return "StepIndex";
+            case IndexedField::WorkflowName: return "WorkflowName";
+            case IndexedField::ProjectNumber: return "ProjectNumber";
+        }
+        return "";
+    }
+
+    /**
+     * fieldByName - Looks up a field by its WorkOrder member name. Returns
+     * false for fields that aren't indexed.
+     */
+    static bool fieldByName(std::string_view name, IndexedField& field) {
+        for (size_t f = 0; f < FIELD_COUNT; f++) {
+            if (name == fieldName(static_cast<IndexedField>(f))) {
+                field = static_cast<IndexedField>(f);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * parseCondition - Parses "Field=Value", e.g. "Status=In Progress".
+     * Throws for a missing = or a field that isn't indexed.
+     */
+    static IndexCondition parseCondition(std::string_view text) {
+        size_t equals = text.find('=');
+        if (equals == std::string_view::npos) {
+            throw std::runtime_error("Filter must look like Field=Value: " + std::string(text));
+        }
+        IndexCondition condition{IndexedField::Status, std::string(text.substr(equals + 1))};
+        if (!fieldByName(text.substr(0, equals), condition.field)) {
+            throw std::runtime_error("Can't filter on " + std::string(text.substr(0, equals)) +
+                                     ", only on Status, Facility, Step, StepIndex, WorkflowName and ProjectNumber");
+        }
+        return condition;
+    }
+
+    size_t size() const {
+        return rowCount;
+    }
+
+    /**
+     * values - The distinct values of field, in order of first appearance.
+     */
+    const std::deque<std::string>& values(IndexedField field) const {
+        return columns[static_cast<size_t>(field)].dictionary;
+    }
+
+    /**
+     * postings - The sorted rows whose field is value; empty if none.
+     */
+    const std::vector<uint32_t>& postings(IndexedField field, std::string_view value) const {
+        static const std::vector<uint32_t> none;
+        const Column& column = columns[static_cast<size_t>(field)];
+        auto it = column.codes.find(value);
+        return it == column.codes.end() ? none : column.postings[it->second];
+    }
+
+    /**
+     * query - The sorted rows that match every field of conditions (and
+     * any of the values given for the same field). No conditions match
+     * every row.
+     *
+     *   1. The values are translated to codes per field; a field none of
+     *      whose values occur matches nothing
+     *   2. The field with the fewest matching rows drives: its posting
+     *      lists are merged into the candidates
+     *   3. Every other field keeps the candidates whose code is one of
+     *      its codes
+     */
+    std::vector<uint32_t> query(const std::vector<IndexCondition>& conditions) const {
+        std::vector<uint32_t> codes[FIELD_COUNT];
+        bool used[FIELD_COUNT] = {};
+        for (const IndexCondition& condition : conditions) {
+            size_t f = static_cast<size_t>(condition.field);
+            used[f] = true;
+            auto it = columns[f].codes.find(condition.value);
+            if (it != columns[f].codes.end()) codes[f].push_back(it->second);
+        }
+
+        size_t driver = FIELD_COUNT;
+        size_t driverRows = 0;
+        for (size_t f = 0; f < FIELD_COUNT; f++) {
+            if (!used[f]) continue;
+            size_t rows = 0;
+            for (uint32_t code : codes[f]) rows += columns[f].postings[code].size();
+            if (driver == FIELD_COUNT || rows < driverRows) {
+                driver = f;
+                driverRows = rows;
+            }
+        }
+
+        std::vector<uint32_t> result;
+        if (driver == FIELD_COUNT) {
+            result.resize(rowCount);
+            for (size_t row = 0; row < rowCount; row++) result[row] = static_cast<uint32_t>(row);
+            return result;
+        }
+
+        std::sort(codes[driver].begin(), codes[driver].end());
+        codes[driver].erase(std::unique(codes[driver].begin(), codes[driver].end()), codes[driver].end());
+        for (uint32_t code : codes[driver]) {
+            const std::vector<uint32_t>& list = columns[driver].postings[code];
+            std::vector<uint32_t> merged;
+            merged.reserve(result.size() + list.size());
+            std::merge(result.begin(), result.end(), list.begin(), list.end(), std::back_inserter(merged));
+            result.swap(merged);
+        }
+
+        for (size_t f = 0; f < FIELD_COUNT; f++) {
+            if (!used[f] || f == driver) continue;
+            const std::vector<uint32_t>& rows = columns[f].rows;
+            const std::vector<uint32_t>& wanted = codes[f];
+            result.erase(std::remove_if(result.begin(), result.end(), [&](uint32_t row) {
+                return std::find(wanted.begin(), wanted.end(), rows[row]) == wanted.end();
+            }), result.end());
+        }
+        return result;
+    }
+
+private:
+    /**
+     * Column - One dictionary encoded field. dictionary is a deque so the
+     * string_view keys of codes stay valid while it grows.
+     */
+    struct Column {
+        std::deque<std::string> dictionary;
+        std::unordered_map<std::string_view, uint32_t> codes;
+        std::vector<uint32_t> rows;
+        std::vector<std::vector<uint32_t>> postings;
+    };
+
+    /**
+     * codeOf - The code of value in column, adding it if it is new.
+     */
+    static uint32_t codeOf(Column& column, std::string_view value) {
+        auto it = column.codes.find(value);
+        if (it != column.codes.end()) return it->second;
+        uint32_t code = static_cast<uint32_t>(column.dictionary.size());
+        column.dictionary.emplace_back(value);
+        column.codes.emplace(column.dictionary.back(), code);
+        column.postings.emplace_back();
+        return code;
+    }
+
+    /**
+     * internedOf - The field if it is an InternedString, whose id gives
+     * its code without hashing the text; nullptr otherwise.
+     */
+    static const InternedString* internedOf(const WorkOrder& w, IndexedField field) {
+        switch (field) {
+            case IndexedField::Status: return &w.Status;
+            case IndexedField::Facility: return &w.Facility;
+            case IndexedField::Step: return &w.Step;
+            case IndexedField::WorkflowName: return &w.WorkflowName;
+            default: return nullptr;
+        }
+    }
+
+    static std::string_view valueOf(const WorkOrder& w, IndexedField field, std::string& scratch) {
+        switch (field) {
+            case IndexedField::Status: return w.Status;
+            case IndexedField::Facility: return w.Facility;
+            case IndexedField::Step: return w.Step;
+            case IndexedField::StepIndex: scratch = std::to_string(w.StepIndex); return scratch;
+            case IndexedField::WorkflowName: return w.WorkflowName;
+            case IndexedField::ProjectNumber: return w.ProjectNumber;
+        }
+        return {};
+    }
+
+    size_t rowCount;
+    Column columns[FIELD_COUNT];
+};
+
+#endif
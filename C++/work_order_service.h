@@ -0,0 +1,375 @@
+/**
+ * Work Order Service
+ *
+ * Keeps the latest response of every endpoint in memory and serves it
+ * over local HTTP, so consumers read a snapshot in microseconds instead of
+ * starting a process that pays for cURL setup, TLS and the whole API call.
+ *
+ *   1. A background thread refreshes every endpoint on an interval, with
+ *      the validators of the snapshot it has, so an unchanged endpoint
+ *      costs a 304
+ *   2. Snapshots are immutable. A refresh builds a new ServiceState and
+ *      swaps it in with one atomic pointer store; readers load the
+ *      pointer and keep whatever they loaded for as long as they need it
+ *   3. A failed refresh keeps serving the previous snapshot and shows up
+ *      in /healthz
+ *   4. projectWorkOrders is also decoded and indexed when it changes, so
+ *      /projectWorkOrders?Status=...&Facility=... is answered from the
+ *      WorkOrderIndex instead of by scanning
+ *
+ * Readers never wait for a refresh, and a refresh never waits for
+ * readers: the only thing they share is the shared_ptr to the current
+ * state.
+ *
+ * Header only, include it from work_orders.cpp.
+ */
+
+#ifndef WORK_ORDER_SERVICE_H
+#define WORK_ORDER_SERVICE_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "http_server.h"
+#include "innergy_client.h"
+#include "json_writer.h"
+#include "work_order.h"
+#include "work_order_index.h"
+
+/**
+ * ServedEndpoint - The snapshot of one endpoint.
+ *
+ * body is null until the first successful fetch. fetchedAt is when the
+ * body was last confirmed current, by a 200 or a 304; lastAttempt and
+ * error describe the latest refresh, successful or not. etag is what
+ * readers get, a hash of the body. workOrders and index are only set for
+ * projectWorkOrders.
+ */
+struct ServedEndpoint {
+    std::string endpoint;
+    std::shared_ptr<const std::string> body;
+    std::shared_ptr<const WorkOrderBatch> workOrders;
+    std::shared_ptr<const WorkOrderIndex> index;
+    Validators validators;
+    std::string etag;
+    std::time_t fetchedAt = 0;
+    std::time_t lastAttempt = 0;
+    std::string error;
+};
+
+/**
+ * ServiceState - The snapshots of all endpoints at one point in time.
+ */
+struct ServiceState {
+    std::map<std::string, std::shared_ptr<const ServedEndpoint>> endpoints;
+
+    bool ready() const {
+        for (const auto& entry : endpoints) {
+            if (!entry.second->body) return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * RefreshObserver - Called after every refresh of an endpoint with the
+ * new snapshot and what happened: "updated", "not_modified" or "failed".
+ */
+using RefreshObserver = std::function<void(const ServedEndpoint&, const char* outcome)>;
+
+/**
+ * WorkOrderService - Refreshes endpoints in the background and answers
+ * HTTP requests from the current snapshots.
+ *
+ *   1. start() starts the refresh thread; its first refresh runs right
+ *      away, and until it has finished requests get 503
+ *   2. handle() is an HttpHandler for GET /<endpoint> and GET /healthz
+ *   3. stop() (or the destructor) ends the refresh thread, after the
+ *      refresh that is running, if any, has finished
+ */
+class WorkOrderService {
+public:
+    WorkOrderService(InnergyClient& client, std::vector<std::string> endpoints, std::chrono::seconds interval)
+        : client(client), endpointNames(std::move(endpoints)), interval(interval) {
+        auto initial = std::make_shared<ServiceState>();
+        for (const std::string& endpoint : endpointNames) {
+            auto served = std::make_shared<ServedEndpoint>();
+            served->endpoint = endpoint;
+            initial->endpoints[endpoint] = served;
+        }
+        current = initial;
+    }
+
+    ~WorkOrderService() {
+        stop();
+    }
+
+    WorkOrderService(const WorkOrderService&) = delete;
+    WorkOrderService& operator=(const WorkOrderService&) = delete;
+
+    /**
+     * setObserver - Calls observer after every refresh of an endpoint, on
+     * the refresh thread. Set it before start().
+     */
+    void setObserver(RefreshObserver observer) {
+        this->observer = std::move(observer);
+    }
+
+    void start() {
+        stopping = false;
+        refresher = std::thread([this] { refreshLoop(); });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (refresher.joinable()) refresher.join();
+    }
+
+    /**
+     * state - The current snapshots. Never blocks on a refresh; the state
+     * returned stays valid and unchanged however long it is held.
+     */
+    std::shared_ptr<const ServiceState> state() const {
+        return std::atomic_load(&current);
+    }
+
+    /**
+     * refresh - Fetches every endpoint once, conditionally on the snapshot
+     * it has, and publishes each result as soon as it is in.
+     */
+    void refresh() {
+        for (const std::string& endpoint : endpointNames) {
+            std::shared_ptr<const ServedEndpoint> previous = state()->endpoints.at(endpoint);
+            auto next = std::make_shared<ServedEndpoint>(*previous);
+            next->lastAttempt = std::time(nullptr);
+            next->error.clear();
+            const char* outcome;
+
+            try {
+                FetchResult result = client.fetchIfChanged(endpoint, previous->body ? previous->validators : Validators());
+                if (result.notModified()) {
+                    if (!previous->body) throw std::runtime_error("API returned 304 but there is no snapshot");
+                    if (endpoint == INDEXED_ENDPOINT && !next->index) buildIndex(*next);
+                    outcome = "not_modified";
+                } else {
+                    next->etag = etagOf(result.body);
+                    next->body = std::make_shared<const std::string>(std::move(result.body));
+                    next->validators = result.validators;
+                    if (endpoint == INDEXED_ENDPOINT) buildIndex(*next);
+                    outcome = "updated";
+                }
+                next->fetchedAt = next->lastAttempt;
+            } catch (const std::exception& e) {
+                next->error = e.what();
+                outcome = "failed";
+            }
+
+            publish(next);
+            if (observer) observer(*next, outcome);
+        }
+    }
+
+    /**
+     * handle - Answers one request from the current state.
+     *
+     *   1. GET /healthz: 200 once every endpoint has data, 503 before,
+     *      with the age and last error of every endpoint
+     *   2. GET /<endpoint>: the latest response of that endpoint as the
+     *      API sent it, with an ETag (If-None-Match gets a 304) and an
+     *      Age header; 503 if it hasn't been fetched yet
+     *   3. GET /projectWorkOrders?Field=Value&...: the matching work
+     *      orders as {"count": n, "workOrders": [...]}, see
+     *      WorkOrderIndex::query; 400 for fields that aren't indexed
+     *   4. Anything else is 404, or 405 for other methods than GET/HEAD
+     */
+    HttpResponse handle(const HttpRequest& request) const {
+        HttpResponse response;
+        if (request.method != "GET" && request.method != "HEAD") {
+            response.status = 405;
+            response.body = "Method not allowed\n";
+            return response;
+        }
+
+        std::shared_ptr<const ServiceState> snapshot = state();
+        std::time_t now = std::time(nullptr);
+
+        if (request.path == "/healthz") {
+            response.status = snapshot->ready() ? 200 : 503;
+            response.contentType = "application/json";
+            response.body = healthJson(*snapshot, now);
+            return response;
+        }
+
+        auto it = request.path.size() > 1 ? snapshot->endpoints.find(request.path.substr(1)) : snapshot->endpoints.end();
+        if (it == snapshot->endpoints.end()) {
+            response.status = 404;
+            response.body = "Not found\n";
+            return response;
+        }
+
+        const ServedEndpoint& served = *it->second;
+        if (!served.body) {
+            response.status = 503;
+            response.body = served.error.empty() ? "Not fetched yet\n" : served.error + "\n";
+            response.headers.emplace_back("Retry-After", "5");
+            return response;
+        }
+
+        response.headers.emplace_back("Age", std::to_string(std::max<std::time_t>(0, now - served.fetchedAt)));
+        response.headers.emplace_back("Cache-Control", "no-cache");
+        if (!request.query.empty()) {
+            query(served, request, response);
+            return response;
+        }
+
+        response.headers.emplace_back("ETag", served.etag);
+        if (request.header("if-none-match") == served.etag) {
+            response.status = 304;
+            return response;
+        }
+
+        response.contentType = "application/json";
+        response.sharedBody = served.body;
+        return response;
+    }
+
+private:
+    static constexpr const char* INDEXED_ENDPOINT = "projectWorkOrders";
+
+    /**
+     * buildIndex - Decodes the new body of served and indexes it. If that
+     * fails the raw body is still served, only queries are not.
+     */
+    static void buildIndex(ServedEndpoint& served) {
+        served.workOrders.reset();
+        served.index.reset();
+        try {
+            auto workOrders = std::make_shared<const WorkOrderBatch>(decodeWorkOrders(served.body));
+            served.index = std::make_shared<const WorkOrderIndex>(workOrders->items);
+            served.workOrders = std::move(workOrders);
+        } catch (const std::exception& e) {
+            served.error = std::string("Indexing failed: ") + e.what();
+        }
+    }
+
+    /**
+     * query - Answers a request with query parameters from the index of
+     * served.
+     */
+    static void query(const ServedEndpoint& served, const HttpRequest& request, HttpResponse& response) {
+        if (served.endpoint != INDEXED_ENDPOINT) {
+            response.status = 400;
+            response.body = "Only " + std::string(INDEXED_ENDPOINT) + " can be queried\n";
+            return;
+        }
+        if (!served.index) {
+            response.status = 503;
+            response.body = "Not indexed, see /healthz\n";
+            return;
+        }
+
+        std::vector<IndexCondition> conditions;
+        try {
+            for (const auto& parameter : request.parameters()) {
+                conditions.push_back(WorkOrderIndex::parseCondition(parameter.first + "=" + parameter.second));
+            }
+        } catch (const std::exception& e) {
+            response.status = 400;
+            response.body = std::string(e.what()) + "\n";
+            return;
+        }
+
+        std::vector<uint32_t> rows = served.index->query(conditions);
+        response.contentType = "application/json";
+        response.body = "{\"count\":" + std::to_string(rows.size()) + ",\"workOrders\":[";
+        for (size_t i = 0; i < rows.size(); i++) {
+            if (i > 0) response.body += ',';
+            WorkOrderJson::append(response.body, served.workOrders->items[rows[i]]);
+        }
+        response.body += "]}";
+    }
+
+    /**
+     * etagOf - A strong ETag for body, the hex of its hash.
+     */
+    static std::string etagOf(std::string_view body) {
+        char buffer[24];
+        std::snprintf(buffer, sizeof(buffer), "\"%016zx\"", std::hash<std::string_view>()(body));
+        return buffer;
+    }
+
+    static std::string healthJson(const ServiceState& state, std::time_t now) {
+        std::string json = "{\n  \"status\": \"";
+        json += state.ready() ? "ok" : "starting";
+        json += "\",\n  \"endpoints\": {";
+        bool first = true;
+        for (const auto& entry : state.endpoints) {
+            const ServedEndpoint& served = *entry.second;
+            json += first ? "\n" : ",\n";
+            first = false;
+            json += "    \"" + JsonWriter::escape(served.endpoint) + "\": {";
+            json += "\"ready\": ";
+            json += served.body ? "true" : "false";
+            if (served.body) {
+                json += ", \"ageSeconds\": " + std::to_string(now - served.fetchedAt);
+                json += ", \"bytes\": " + std::to_string(served.body->size());
+            }
+            if (!served.error.empty()) {
+                json += ", \"error\": \"" + JsonWriter::escape(served.error) + "\"";
+            }
+            json += "}";
+        }
+        json += "\n  }\n}\n";
+        return json;
+    }
+
+    /**
+     * publish - Swaps in a copy of the current state with one endpoint
+     * replaced. Only the refresh thread writes, so there is no race
+     * between loading and storing.
+     */
+    void publish(std::shared_ptr<const ServedEndpoint> served) {
+        auto next = std::make_shared<ServiceState>(*state());
+        next->endpoints[served->endpoint] = std::move(served);
+        std::atomic_store(&current, std::shared_ptr<const ServiceState>(std::move(next)));
+    }
+
+    void refreshLoop() {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        while (!stopping) {
+            lock.unlock();
+            refresh();
+            lock.lock();
+            wake.wait_for(lock, interval, [this] { return stopping; });
+        }
+    }
+
+    InnergyClient& client;
+    std::vector<std::string> endpointNames;
+    std::chrono::seconds interval;
+    RefreshObserver observer;
+    std::shared_ptr<const ServiceState> current;
+    std::thread refresher;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+#endif
@@ -15,99 +15,51 @@
  * Run:
  *   ./work_orders
  *   ./work_orders --env-path=/path/to/.env
+ *   ./work_orders --endpoints=projectWorkOrders,projects
+ *   ./work_orders --typed
+ *   ./work_orders --filter="Status=In Progress" --filter=Facility=Main
+ *   ./work_orders --aggregate=Facility --measures=EstimatedCost,ActualCost
+ *   ./work_orders --stream
+ *   ./work_orders --cache-path=work_orders.snapshot
+ *   ./work_orders --cache-path=work_orders.snapshot --max-age=300
+ *   ./work_orders --stats
+ *   ./work_orders --timing
+ *   ./work_orders --metrics-file=/var/lib/node_exporter/work_orders.prom
+ *   ./work_orders --interval=60 --metrics-port=9464
+ *   ./work_orders --base-url=http://127.0.0.1:8080/api/
+ *   ./work_orders --retries=5 --retry-delay-ms=250 --retry-max-delay-ms=10000 --deadline=60
+ *   ./work_orders --endpoints=projectWorkOrders,projects --rate-limit=2 --rate-burst=5
+ *   ./work_orders --serve=127.0.0.1:8080 --interval=60
+ *   ./work_orders --serve=unix:/run/work_orders.sock
  */
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <map>
+#include <thread>
+#include <vector>
+#include <ctime>
 #include <curl/curl.h>
 
-/**
- * JsonWriter - Helper class for JSON string operations.
- *
- * This class provides static methods for working with JSON strings.
- * Since we're not using an external JSON library, we need to handle
- * escaping special characters and formatting manually.
- */
-class JsonWriter {
-public:
-    /**
-     * escape - Escapes special characters in a string for JSON output.
-     * really meant for readability.
-     */
-    static std::string escape(const std::string& s) {
-        std::string result;
-        for (char c : s) {
-            switch (c) {
-                case '"': result += "\\\""; break;
-                case '\\': result += "\\\\"; break;
-                case '\n': result += "\\n"; break;
-                case '\r': result += "\\r"; break;
-                case '\t': result += "\\t"; break;
-                default: result += c;
-            }
-        }
-        return result;
-    }
-
-    /**
-     * prettyPrint - Formats a JSON string with indentation and newlines.
-     *
-     *   1. Iterates through each character in the JSON string
-     *   2. Tracks whether we're inside a quoted string to avoid formatting string contents
-     *   3. When encountering { or [: adds newline and increases indent
-     *   4. When encountering } or ]: decreases indent and adds newline before
-     *   5. When encountering comma: adds newline and current indentation
-     *   6. When encountering colon: adds a space after for readability
-     *   7. Skips whitespace outside of strings, we add our own formatting
-     *   8. Returns the formatted JSON string
-     */
-    static std::string prettyPrint(const std::string& json) {
-        std::string result;
-        int indent = 0;
-        bool inString = false;
-        char prevChar = 0;
-
-        for (size_t i = 0; i < json.length(); i++) {
-            char c = json[i];
-
-            if (c == '"' && prevChar != '\\') {
-                inString = !inString;
-            }
-
-            if (!inString) {
-                if (c == '{' || c == '[') {
-                    result += c;
-                    result += '\n';
-                    indent++;
-                    result += std::string(indent * 2, ' ');
-                } else if (c == '}' || c == ']') {
-                    result += '\n';
-                    indent--;
-                    result += std::string(indent * 2, ' ');
-                    result += c;
-                } else if (c == ',') {
-                    result += c;
-                    result += '\n';
-                    result += std::string(indent * 2, ' ');
-                } else if (c == ':') {
-                    result += c;
-                    result += ' ';
-                } else if (c != ' ' && c != '\n' && c != '\r' && c != '\t') {
-                    result += c;
-                }
-            } else {
-                result += c;
-            }
-
-            prevChar = c;
-        }
-
-        return result;
-    }
-};
+#include "http_server.h"
+#include "innergy_client.h"
+#include "json_writer.h"
+#include "metrics.h"
+#include "snapshot_cache.h"
+#include "work_order.h"
+#include "work_order_aggregate.h"
+#include "work_order_columns.h"
+#include "work_order_index.h"
+#include "work_order_service.h"
 
 /**
  * loadEnvFile - Reads a .env file and returns a map of key-value pairs.
@@ -166,108 +118,611 @@ std::map<std::string, std::string> loadEnvFile(const std::string& filepath) {
 }
 
 /**
- * writeCallback - Callback function for cURL to handle response data.
- *
- *   1. cURL calls this function each time it receives a chunk of data
- *   2. The data comes as a void pointer with size information
- *   3. We calculate the total size * nmemb
- *   4. Cast the void pointer to char* and append to our response string
- *   5. Return the number of bytes processed. cURL expects this
+ * Diagnostics - The optional --stats and --timing parts of the output.
  *
- * Data arrives in chunks, not all at once, so we accumulate it.
+ * The transfer numbers come from the FetchResult of the request, which is
+ * null when the response came from a fresh snapshot. parseMs, formatMs
+ * and records are filled in by whoever parses and formats the body, and
+ * end up in the metrics as well.
+ */
+struct Diagnostics {
+    bool stats = false;
+    bool timing = false;
+    const FetchResult* fetch = nullptr;
+    double parseMs = 0;
+    double formatMs = 0;
+    size_t records = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * millisecondsSince - Time elapsed since start, in milliseconds.
  */
-size_t writeCallback(void* contents, size_t size, size_t nmemb, std::string* response) {
-    size_t totalSize = size * nmemb;
-    response->append((char*)contents, totalSize);
-    return totalSize;
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
 }
 
 /**
- * fetchWorkOrders - Makes an HTTP GET request to the Innergy API.
- *
- *   1. Initializes a cURL easy handle the connection object
- *   2. Creates an empty string to store the response
- *   3. Sets up HTTP headers: Accept for JSON, Api-Key for auth
- *   4. Configures cURL options:
- *      - URL: the API endpoint
- *      - Headers: our custom headers list
- *      - Write function: our callback to handle response
- *      - Write data: pointer to our response string
- *      - Timeout: 120 seconds for large responses
- *   5. Executes the request with curl_easy_perform
- *   6. Gets the HTTP response code
- *   7. Cleans up the headers list and cURL handle
- *   8. Checks for cURL errors and throws if any
- *   9. Checks HTTP status code and throws if not 2xx
- *   10. Returns the response string
+ * formatMilliseconds - Formats a duration in milliseconds with three
+ * decimals, without touching the formatting state of std::cout.
  */
-std::string fetchWorkOrders(const std::string& apiKey) {
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        throw std::runtime_error("Failed to initialize cURL");
+std::string formatMilliseconds(double ms) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f", ms);
+    return buffer;
+}
+
+/**
+ * metrics - The metrics of this process, exported with --metrics-file and
+ * --metrics-port.
+ */
+MetricsRegistry& metrics() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+/**
+ * TransferMetrics - The series of one endpoint that every finished request
+ * updates, looked up in the registry once instead of on every transfer.
+ * The status code counters are looked up the first time a code is seen
+ * and kept in responses.
+ */
+class TransferMetrics {
+public:
+    explicit TransferMetrics(const std::string& endpoint)
+        : endpoint(endpoint),
+          requests(metrics().counter("work_orders_requests_total", "API requests made.", labels())),
+          transportErrors(metrics().counter("work_orders_transport_errors_total",
+                                            "API requests that failed without a complete response.", labels())),
+          retries(metrics().counter("work_orders_retries_total", "API requests that were retries of a failed one.",
+                                    labels())),
+          wireBytes(metrics().counter("work_orders_wire_bytes_total", "Response bytes received, before decompression.",
+                                      labels())),
+          decodedBytes(metrics().counter("work_orders_decoded_bytes_total", "Response bytes after decompression.",
+                                         labels())),
+          duration(metrics().histogram("work_orders_request_duration_seconds",
+                                       "Time from the start of a request to its last byte.",
+                                       Histogram::latencyBuckets(), labels())),
+          firstByte(metrics().histogram("work_orders_first_byte_seconds",
+                                        "Time from the start of a request to its first response byte.",
+                                        Histogram::latencyBuckets(), labels())),
+          rateLimitWait(metrics().histogram("work_orders_rate_limit_wait_seconds",
+                                            "Time a request waited for the client side rate limiter.",
+                                            Histogram::latencyBuckets(), labels())) {}
+
+    /**
+     * record - Records one finished request.
+     *
+     *   1. Counts the request and its status code; a transfer that never
+     *      got a response (DNS, connect, timeout) is counted under code "0"
+     *      and as a transport error. Every attempt counts, and attempts
+     *      after the first are counted as retries too
+     *   2. Adds the bytes received on the wire and after decompression
+     *   3. Observes the total time and the time to the first byte
+     *   4. Observes how long the request waited for the rate limiter
+     */
+    void record(const FetchResult& result) {
+        requests.inc();
+        response(result.httpCode).inc();
+        if (result.curlCode != CURLE_OK) transportErrors.inc();
+        if (result.retries > 0) retries.inc();
+
+        wireBytes.inc(static_cast<uint64_t>(result.stats.wireBytes));
+        decodedBytes.inc(static_cast<uint64_t>(result.stats.bodyBytes));
+
+        duration.observe(result.timing.total / 1e6);
+        firstByte.observe(result.timing.startTransfer / 1e6);
+        rateLimitWait.observe(std::chrono::duration<double>(result.queueWait).count());
+    }
+
+private:
+    MetricLabels labels() const {
+        return {{"endpoint", endpoint}};
     }
 
-    std::string response;
-    std::string url = "https://app.innergy.com/api/projectWorkOrders";
+    /**
+     * response - The response counter of code. Two threads seeing a new
+     * code at once both get the same series from the registry.
+     */
+    Counter& response(long code) {
+        auto lookup = [&] {
+            return &metrics().counter("work_orders_responses_total", "API responses by HTTP status code.",
+                                      {{"endpoint", endpoint}, {"code", std::to_string(code)}});
+        };
+        if (code < 0 || code >= static_cast<long>(responses.size())) return *lookup();
+        std::atomic<Counter*>& cached = responses[static_cast<size_t>(code)];
+        Counter* counter = cached.load(std::memory_order_acquire);
+        if (!counter) {
+            counter = lookup();
+            cached.store(counter, std::memory_order_release);
+        }
+        return *counter;
+    }
+
+    std::string endpoint;
+    Counter& requests;
+    Counter& transportErrors;
+    Counter& retries;
+    Counter& wireBytes;
+    Counter& decodedBytes;
+    Histogram& duration;
+    Histogram& firstByte;
+    Histogram& rateLimitWait;
+    std::array<std::atomic<Counter*>, 600> responses{};
+};
+
+/**
+ * transferRecorder - An observer for the client that records every
+ * finished request, failed ones included, in the series of its endpoint.
+ * The series of endpoints are created up front; a request to any other
+ * endpoint looks its series up in the registry.
+ */
+TransferObserver transferRecorder(const std::vector<std::string>& endpoints) {
+    auto byEndpoint = std::make_shared<std::map<std::string, TransferMetrics>>();
+    for (const std::string& endpoint : endpoints) {
+        byEndpoint->emplace(std::piecewise_construct, std::forward_as_tuple(endpoint), std::forward_as_tuple(endpoint));
+    }
+    return [byEndpoint](const FetchResult& result) {
+        auto it = byEndpoint->find(result.endpoint);
+        if (it != byEndpoint->end()) {
+            it->second.record(result);
+        } else {
+            TransferMetrics(result.endpoint).record(result);
+        }
+    };
+}
 
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, "Accept: application/json");
-    std::string apiKeyHeader = "Api-Key: " + apiKey;
-    headers = curl_slist_append(headers, apiKeyHeader.c_str());
+/**
+ * watchRateLimiter - Exports how long a request made now would wait for
+ * bucket, read from the bucket whenever the metrics are rendered, so it
+ * shows the current queue even when no request has finished lately.
+ * limiter is kept alive by the gauge, since bucket belongs to it.
+ */
+void watchRateLimiter(std::shared_ptr<RateLimiter> limiter, TokenBucket& bucket, const std::string& host) {
+    metrics().gaugeFunction("work_orders_rate_limit_queue_wait_seconds",
+                            "How long a request made now would wait for the client side rate limiter.",
+                            {{"host", host}}, [limiter, &bucket] {
+                                return std::chrono::duration<double>(bucket.currentWait()).count();
+                            });
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 120L);
+/**
+ * recordOutput - Records the parse and format times and the number of
+ * records of a response that was output.
+ */
+void recordOutput(const std::string& endpoint, const Diagnostics& diagnostics) {
+    MetricsRegistry& registry = metrics();
+    MetricLabels labels = {{"endpoint", endpoint}};
 
-    CURLcode res = curl_easy_perform(curl);
+    registry.histogram("work_orders_parse_seconds", "Time spent parsing or indexing a response.",
+                       Histogram::processingBuckets(), labels)
+        .observe(diagnostics.parseMs / 1000);
+    registry.histogram("work_orders_format_seconds", "Time spent pretty printing a response.",
+                       Histogram::processingBuckets(), labels)
+        .observe(diagnostics.formatMs / 1000);
+    registry.gauge("work_orders_records", "Records in the last response that was output.", labels)
+        .set(static_cast<double>(diagnostics.records));
+}
 
-    long httpCode = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
+/**
+ * recordSnapshotServed - Counts a response served from the snapshot cache,
+ * because it was fresh enough ("fresh") or the server answered 304
+ * ("not_modified").
+ */
+void recordSnapshotServed(const std::string& endpoint, const char* reason) {
+    metrics().counter("work_orders_snapshot_served_total", "Responses served from the snapshot cache.",
+                      {{"endpoint", endpoint}, {"reason", reason}}).inc();
+}
 
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+/**
+ * recordRun - Records the outcome of one run, so an alert can fire on
+ * work_orders_last_run_success == 0 or on a stale timestamp.
+ */
+void recordRun(bool success) {
+    MetricsRegistry& registry = metrics();
+    registry.counter("work_orders_runs_total", "Runs by outcome.", {{"result", success ? "success" : "failure"}}).inc();
+    registry.gauge("work_orders_last_run_success", "1 if the last run succeeded, 0 if it failed.").set(success ? 1 : 0);
+    registry.gauge("work_orders_last_run_timestamp_seconds", "Unix time the last run finished.")
+        .set(static_cast<double>(std::time(nullptr)));
+}
 
-    if (res != CURLE_OK) {
-        throw std::runtime_error(std::string("cURL error: ") + curl_easy_strerror(res));
+/**
+ * recordRefresh - Records one background refresh of an endpoint in --serve
+ * mode. The timestamp is when the served data was last confirmed current,
+ * so an alert can fire when it falls behind.
+ */
+void recordRefresh(const ServedEndpoint& served, const char* outcome) {
+    MetricsRegistry& registry = metrics();
+    registry.counter("work_orders_refreshes_total", "Background refreshes by outcome.",
+                     {{"endpoint", served.endpoint}, {"outcome", outcome}}).inc();
+    if (served.body) {
+        MetricLabels endpoint = {{"endpoint", served.endpoint}};
+        registry.gauge("work_orders_served_timestamp_seconds", "Unix time the served data was last confirmed current.", endpoint)
+            .set(static_cast<double>(served.fetchedAt));
+        registry.gauge("work_orders_served_bytes", "Size of the served response.", endpoint)
+            .set(static_cast<double>(served.body->size()));
+    }
+    if (!served.error.empty()) {
+        std::cerr << "warning: refreshing " << served.endpoint << " failed: " << served.error << std::endl;
     }
+}
 
-    if (httpCode < 200 || httpCode >= 300) {
-        throw std::runtime_error("API returned status " + std::to_string(httpCode));
+/**
+ * outputDiagnostics - Outputs the members asked for with --stats and
+ * --timing. indent is the indentation of the members themselves.
+ *
+ *   1. retries: how many failed attempts came before the response, only
+ *      printed if there were any
+ *   2. transfer (--stats): the Content-Encoding of the response and its
+ *      size on the wire and after decompression
+ *   3. timing (--timing): the time spent waiting for the rate limiter,
+ *      cURL's phase times (DNS, TCP connect, TLS, first byte, total) in
+ *      milliseconds since the request started, the download size and
+ *      speed, then the local parse and format time
+ */
+void outputDiagnostics(const Diagnostics& diagnostics, const std::string& indent) {
+    const FetchResult* fetch = diagnostics.fetch;
+
+    if (fetch && fetch->retries > 0) {
+        std::cout << indent << "\"retries\": " << fetch->retries << ",\n";
     }
 
-    return response;
+    if (diagnostics.stats && fetch) {
+        const TransferStats& stats = fetch->stats;
+        std::cout << indent << "\"transfer\": {\n";
+        std::cout << indent << "  \"encoding\": \"" << JsonWriter::escape(stats.encoding.empty() ? "identity" : stats.encoding) << "\",\n";
+        std::cout << indent << "  \"compressedBytes\": " << stats.wireBytes << ",\n";
+        std::cout << indent << "  \"decompressedBytes\": " << stats.bodyBytes << "\n";
+        std::cout << indent << "},\n";
+    }
+
+    if (diagnostics.timing) {
+        std::cout << indent << "\"timing\": {\n";
+        if (fetch) {
+            const TransferTiming& timing = fetch->timing;
+            auto phase = [&](const char* name, curl_off_t microseconds) {
+                std::cout << indent << "  \"" << name << "\": " << formatMilliseconds(microseconds / 1000.0) << ",\n";
+            };
+            std::cout << indent << "  \"queueMs\": "
+                      << formatMilliseconds(std::chrono::duration<double, std::milli>(fetch->queueWait).count()) << ",\n";
+            phase("nameLookupMs", timing.nameLookup);
+            phase("connectMs", timing.connect);
+            phase("tlsMs", timing.appConnect);
+            phase("firstByteMs", timing.startTransfer);
+            phase("totalMs", timing.total);
+            std::cout << indent << "  \"downloadBytes\": " << fetch->stats.wireBytes << ",\n";
+            std::cout << indent << "  \"bytesPerSecond\": " << timing.bytesPerSecond << ",\n";
+        }
+        std::cout << indent << "  \"parseMs\": " << formatMilliseconds(diagnostics.parseMs) << ",\n";
+        std::cout << indent << "  \"formatMs\": " << formatMilliseconds(diagnostics.formatMs) << "\n";
+        std::cout << indent << "},\n";
+    }
 }
 
 /**
  * outputSuccess - Outputs a success JSON response to stdout.
  *
- *   1. Counts the number of work orders by finding "Id": patterns
- *      Simple parsing without a JSON library
- *   2. Pretty prints the API response using JsonWriter::prettyPrint
- *   3. Outputs a JSON object with:
+ *   1. Pretty prints the API response using JsonWriter::prettyPrint,
+ *      which counts the elements of the top-level Items array in the
+ *      same pass
+ *   2. Outputs a JSON object with:
  *      - success: true
- *      - count: number of items found
+ *      - count: number of work orders in Items
+ *      - transfer / timing: if asked for in diagnostics; the response
+ *        isn't parsed apart from pretty printing, which counts as
+ *        formatting
  *      - data: the formatted API response
  */
-void outputSuccess(const std::string& apiResponse) {
-    int count = 0;
-    size_t pos = 0;
-    while ((pos = apiResponse.find("\"Id\":", pos)) != std::string::npos) {
-        count++;
-        pos++;
-    }
-
-    std::string formattedData = JsonWriter::prettyPrint(apiResponse);
+void outputSuccess(std::string_view apiResponse, Diagnostics* diagnostics = nullptr) {
+    size_t count = 0;
+    Clock::time_point start = Clock::now();
+    std::string formattedData = JsonWriter::prettyPrint(apiResponse, &count);
+    double formatMs = millisecondsSince(start);
 
     std::cout << "{\n";
     std::cout << "  \"success\": true,\n";
     std::cout << "  \"count\": " << count << ",\n";
+    if (diagnostics) {
+        diagnostics->formatMs += formatMs;
+        diagnostics->records = count;
+        outputDiagnostics(*diagnostics, "  ");
+    }
     std::cout << "  \"data\": " << formattedData << "\n";
     std::cout << "}" << std::endl;
 }
 
+/**
+ * outputWorkOrders - Outputs decoded work orders like the Go example does.
+ *
+ *   1. Serializes the WorkOrder structs with WorkOrderJson
+ *   2. Pretty prints them using JsonWriter::prettyPrint
+ *   3. Outputs a JSON object with:
+ *      - success: true
+ *      - transfer / timing: if asked for in diagnostics; the caller
+ *        records the decode time as parsing
+ *      - workOrders: the decoded work orders
+ *      - count: number of work orders
+ */
+void outputWorkOrders(const std::vector<WorkOrder>& workOrders, Diagnostics* diagnostics = nullptr) {
+    Clock::time_point start = Clock::now();
+    std::string json;
+    WorkOrderJson::append(json, workOrders);
+    std::string formattedData = JsonWriter::prettyPrint(json);
+    double formatMs = millisecondsSince(start);
+
+    std::cout << "{\n";
+    std::cout << "  \"success\": true,\n";
+    if (diagnostics) {
+        diagnostics->formatMs += formatMs;
+        diagnostics->records = workOrders.size();
+        outputDiagnostics(*diagnostics, "  ");
+    }
+    std::cout << "  \"workOrders\": " << formattedData << ",\n";
+    std::cout << "  \"count\": " << workOrders.size() << "\n";
+    std::cout << "}" << std::endl;
+}
+
+/**
+ * outputAggregates - Outputs the aggregates of decoded work orders instead
+ * of the work orders themselves.
+ *
+ *   1. Pretty prints AggregateResult::toJson
+ *   2. Outputs a JSON object with:
+ *      - success: true
+ *      - transfer / timing: if asked for in diagnostics; the caller
+ *        records the aggregation time as parsing
+ *      - aggregates: the groups with the stats of every measure
+ *      - count: number of work orders that were aggregated
+ */
+void outputAggregates(const AggregateResult& aggregates, size_t count, Diagnostics* diagnostics = nullptr) {
+    Clock::time_point start = Clock::now();
+    std::string formattedData = JsonWriter::prettyPrint(aggregates.toJson());
+    double formatMs = millisecondsSince(start);
+
+    std::cout << "{\n";
+    std::cout << "  \"success\": true,\n";
+    if (diagnostics) {
+        diagnostics->formatMs += formatMs;
+        diagnostics->records = count;
+        outputDiagnostics(*diagnostics, "  ");
+    }
+    std::cout << "  \"aggregates\": " << formattedData << ",\n";
+    std::cout << "  \"count\": " << count << "\n";
+    std::cout << "}" << std::endl;
+}
+
+/**
+ * outputResults - Outputs the results of a concurrent multi-endpoint fetch.
+ *
+ *   1. Outputs one entry per endpoint, in the order they were requested
+ *   2. Successful endpoints get count and data like outputSuccess
+ *   3. Failed endpoints get success: false and the error message
+ *   4. The top level success flag is true only if every endpoint succeeded
+ *   5. With --stats / --timing every endpoint gets its own transfer and
+ *      timing members; diagnostics only says which ones to print
+ *   6. The parse and format times and counts are recorded in the metrics
+ *
+ * Returns whether every endpoint succeeded.
+ */
+bool outputResults(const std::vector<FetchResult>& results, const Diagnostics& diagnostics) {
+    bool allOk = true;
+    for (const auto& result : results) {
+        allOk = allOk && result.ok();
+    }
+
+    std::cout << "{\n";
+    std::cout << "  \"success\": " << (allOk ? "true" : "false") << ",\n";
+    std::cout << "  \"results\": {\n";
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const FetchResult& result = results[i];
+        std::cout << "    \"" << JsonWriter::escape(result.endpoint) << "\": {\n";
+        if (result.ok()) {
+            Diagnostics endpointDiagnostics = diagnostics;
+            endpointDiagnostics.fetch = &result;
+
+            size_t count = 0;
+            Clock::time_point start = Clock::now();
+            std::string formattedData = JsonWriter::prettyPrint(result.body, &count);
+            endpointDiagnostics.formatMs = millisecondsSince(start);
+            endpointDiagnostics.records = count;
+            recordOutput(result.endpoint, endpointDiagnostics);
+
+            std::cout << "      \"success\": true,\n";
+            std::cout << "      \"count\": " << count << ",\n";
+            outputDiagnostics(endpointDiagnostics, "      ");
+            std::cout << "      \"data\": " << formattedData << "\n";
+        } else {
+            std::cout << "      \"success\": false,\n";
+            std::cout << "      \"message\": \"" << JsonWriter::escape(result.error()) << "\"\n";
+        }
+        std::cout << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    std::cout << "  }\n";
+    std::cout << "}" << std::endl;
+    return allOk;
+}
+
+/**
+ * outputStream - Fetches an endpoint and prints it formatted as it arrives.
+ *
+ *   1. Nothing is printed until the first chunk of a 2xx response arrives,
+ *      so errors before that are reported with outputError as usual
+ *   2. The first chunk prints the opening of the output object and "data"
+ *   3. Every chunk is formatted with JsonStreamFormatter and written to
+ *      stdout right away, then the buffer is cleared for the next chunk
+ *   4. count and success come last, since they are only known once the
+ *      transfer ends
+ *   5. If the transfer fails half way, or the response ends inside a
+ *      string, escape or container, the formatter closes what is open
+ *      and success: false with the message follows, so the output is
+ *      still valid JSON
+ *   6. If a snapshot writer is given, every chunk is also appended to it
+ *   7. The request is conditional on since; a 304 prints nothing, the
+ *      caller outputs its cached copy instead
+ *   8. The transfer and timing members asked for in diagnostics follow
+ *      the count; the time spent in the formatter counts as formatting
+ *
+ * Returns the result of the fetch. After a failure half way or a truncated
+ * response it is not ok(), so the snapshot is not committed.
+ */
+FetchResult outputStream(InnergyClient& client, const std::string& endpoint, SnapshotWriter* snapshot,
+                         const Validators& since, Diagnostics& diagnostics) {
+    JsonStreamFormatter formatter;
+    std::string buffer;
+    bool started = false;
+    FetchResult result;
+
+    try {
+        result = client.fetchStreaming(endpoint, [&](const char* data, size_t size) {
+            if (!started) {
+                std::cout << "{\n";
+                std::cout << "  \"data\": ";
+                started = true;
+            }
+            Clock::time_point start = Clock::now();
+            formatter.feed(data, size, buffer);
+            diagnostics.formatMs += millisecondsSince(start);
+            if (snapshot) snapshot->append(data, size);
+            std::cout.write(buffer.data(), buffer.size());
+            std::cout.flush();
+            buffer.clear();
+        }, since);
+    } catch (const std::exception& e) {
+        if (!started) throw;
+
+        formatter.close(buffer);
+        std::cout << buffer << ",\n";
+        std::cout << "  \"success\": false,\n";
+        std::cout << "  \"message\": \"" << JsonWriter::escape(e.what()) << "\"\n";
+        std::cout << "}" << std::endl;
+        return FetchResult();
+    }
+
+    if (result.notModified()) {
+        return result;
+    }
+
+    if (!started) {
+        throw std::runtime_error("API returned an empty response");
+    }
+
+    if (!formatter.close(buffer)) {
+        std::cout << buffer << ",\n";
+        std::cout << "  \"success\": false,\n";
+        std::cout << "  \"message\": \"The response ended before the JSON document did\"\n";
+        std::cout << "}" << std::endl;
+        return FetchResult();
+    }
+    std::cout << buffer << ",\n";
+    diagnostics.records = formatter.itemCount();
+    std::cout << "  \"count\": " << diagnostics.records << ",\n";
+    diagnostics.fetch = &result;
+    outputDiagnostics(diagnostics, "  ");
+    std::cout << "  \"success\": true\n";
+    std::cout << "}" << std::endl;
+    return result;
+}
+
+/**
+ * WorkOrderQuery - What to output of decoded work orders: the ones that
+ * match filters, or with aggregateBy set their aggregates.
+ */
+struct WorkOrderQuery {
+    std::vector<IndexCondition> filters;
+    std::string aggregateBy;
+    std::vector<std::string> measures = WorkOrderAggregator::defaultMeasures();
+};
+
+/**
+ * filterWorkOrders - Keeps the work orders that match filters (see
+ * WorkOrderIndex::query), in their original order. Building the index and
+ * querying it count as parsing.
+ */
+void filterWorkOrders(std::vector<WorkOrder>& workOrders, const std::vector<IndexCondition>& filters,
+                      Diagnostics& diagnostics) {
+    if (filters.empty()) return;
+
+    Clock::time_point start = Clock::now();
+    std::vector<uint32_t> rows = WorkOrderIndex(workOrders).query(filters);
+    std::vector<WorkOrder> matches;
+    matches.reserve(rows.size());
+    for (uint32_t row : rows) {
+        matches.push_back(std::move(workOrders[row]));
+    }
+    workOrders.swap(matches);
+    diagnostics.parseMs += millisecondsSince(start);
+}
+
+/**
+ * outputTyped - Outputs decoded work orders as query asks: filtered, then
+ * either as they are or aggregated. Building the columns and aggregating
+ * count as parsing.
+ */
+void outputTyped(std::vector<WorkOrder>& workOrders, const WorkOrderQuery& query, Diagnostics& diagnostics) {
+    filterWorkOrders(workOrders, query.filters, diagnostics);
+    if (query.aggregateBy.empty()) {
+        outputWorkOrders(workOrders, &diagnostics);
+        return;
+    }
+
+    Clock::time_point start = Clock::now();
+    WorkOrderColumns columns(workOrders);
+    AggregateResult aggregates = WorkOrderAggregator(columns).aggregate(query.aggregateBy, query.measures);
+    diagnostics.parseMs += millisecondsSince(start);
+    outputAggregates(aggregates, workOrders.size(), &diagnostics);
+}
+
+/**
+ * outputSnapshot - Outputs a cached response the same way as a fresh one.
+ * diagnostics.fetch is the 304 that confirmed it, if there was one.
+ */
+void outputSnapshot(const MappedSnapshot& snapshot, bool typed, const WorkOrderQuery& query,
+                    Diagnostics& diagnostics) {
+    if (typed) {
+        Clock::time_point start = Clock::now();
+        WorkOrderBatch workOrders = decodeWorkOrdersBorrowed(snapshot.body());
+        diagnostics.parseMs += millisecondsSince(start);
+        outputTyped(workOrders.items, query, diagnostics);
+    } else {
+        outputSuccess(snapshot.body(), &diagnostics);
+    }
+}
+
+/**
+ * saveSnapshot - Updates the snapshot cache after a fetch.
+ *
+ *   1. A 2xx response commits the snapshot that was written while it
+ *      downloaded, with its source, the fetch time and the validators of
+ *      the response
+ *   2. A 304 keeps the cached body and writes it to a new snapshot with
+ *      the new fetch time, so --max-age counts from this check
+ *   3. The snapshot is only there to speed up later runs, so a failure
+ *      is reported on stderr and doesn't fail this run
+ */
+void saveSnapshot(const std::string& path, SnapshotWriter& writer, const MappedSnapshot* previous,
+                  const SnapshotInfo& source, const FetchResult& result, std::time_t fetchedAt) {
+    SnapshotInfo info = source;
+    info.fetchedAt = fetchedAt;
+    info.etag = result.validators.etag;
+    info.lastModified = result.validators.lastModified;
+    std::string error;
+
+    if (result.ok()) {
+        if (!writer.commit(info)) error = writer.error();
+    } else if (result.notModified() && previous) {
+        if (info.etag.empty()) info.etag = previous->info().etag;
+        if (info.lastModified.empty()) info.lastModified = previous->info().lastModified;
+        SnapshotWriter::refresh(path, info, previous->body(), error);
+    }
+
+    if (!error.empty()) {
+        std::cerr << "warning: " << error << std::endl;
+    }
+}
+
 /**
  * outputError - Outputs an error JSON response to stdout.
  *
@@ -285,57 +740,491 @@ void outputError(const std::string& message) {
 }
 
 /**
- * parseEnvPath - Parses command line arguments for the --env-path option.
+ * Options - Command line settings for one run of the program.
+ */
+struct Options {
+    std::string envPath = "../.env";
+    std::string baseUrl;
+    std::vector<std::string> endpoints = {"projectWorkOrders"};
+    bool typed = false;
+    WorkOrderQuery query;
+    bool stream = false;
+    RetryPolicy retry;
+    double rateLimit = 0;
+    double rateBurst = 1;
+    std::string cachePath;
+    long long maxAge = -1;
+    bool stats = false;
+    bool timing = false;
+    std::string metricsFile;
+    int metricsPort = 0;
+    long long interval = 0;
+    std::string serve;
+};
+
+/**
+ * splitList - Splits a comma separated value into its non-empty parts.
+ */
+std::vector<std::string> splitList(const std::string& value) {
+    std::vector<std::string> parts;
+    std::stringstream stream(value);
+    std::string part;
+    while (std::getline(stream, part, ',')) {
+        if (!part.empty()) {
+            parts.push_back(part);
+        }
+    }
+    return parts;
+}
+
+/**
+ * parseOptions - Parses command line arguments into an Options struct.
  *
  * How it works:
- *   1. Sets a default path for the .env file
+ *   1. Starts from the defaults in Options
  *   2. Loops through all command line arguments
- *   3. Looks for arguments starting with "--env-path="
- *   4. Extracts the path after the = sign
- *   5. Returns the path
+ *   3. "--env-path=" sets the path of the .env file
+ *   4. "--endpoints=" sets a comma separated list of API endpoints,
+ *      e.g. --endpoints=projectWorkOrders,projects
+ *   5. "--typed" decodes work orders into WorkOrder structs and outputs
+ *      them in the same shape as the Go example; "--filter=Field=Value"
+ *      (repeatable, implies --typed) outputs only the matching ones;
+ *      "--aggregate=Field" (implies --typed) outputs the totals of the
+ *      money fields listed in "--measures=" per value of Field and per
+ *      currency instead. These decode projectWorkOrders only, so they
+ *      can't be combined with other --endpoints
+ *   6. "--stream" prints the response formatted as it downloads
+ *   7. "--cache-path=" turns the snapshot cache on and sets its file; it
+ *      is off by default, so a plain run leaves no copy of the data
+ *   8. "--max-age=" serves the snapshot instead of fetching when it is
+ *      at most this many seconds old; it needs --cache-path. --stream,
+ *      --cache-path and --max-age work on one endpoint only
+ *   9. "--stats" adds compressed and decompressed byte counts
+ *   10. "--timing" adds the time spent in each phase of the request and
+ *       in parsing and formatting
+ *   11. "--metrics-file=" writes the metrics there after every run
+ *   12. "--metrics-port=" serves the metrics on 127.0.0.1:port/metrics
+ *   13. "--interval=" repeats the run every this many seconds instead of
+ *       exiting after the first one
+ *   14. "--base-url=" sends the requests somewhere else than the Innergy
+ *       API, e.g. to mock_server
+ *   15. "--retries=", "--retry-delay-ms=", "--retry-max-delay-ms=" and
+ *       "--deadline=" (seconds) set the retry policy; --retries=0 turns
+ *       retrying off
+ *   16. "--rate-limit=" paces the requests to at most this many per
+ *       second, with bursts of up to "--rate-burst=" requests; 0 (the
+ *       default) doesn't limit
+ *   17. "--serve=" runs as a service instead of printing: host:port, or
+ *       unix:path for a Unix socket; --interval defaults to 60 with it
+ *   18. Returns the options
  */
-std::string parseEnvPath(int argc, char* argv[]) {
-    std::string envPath = "../.env";
+Options parseOptions(int argc, char* argv[]) {
+    Options options;
 
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
         if (arg.find("--env-path=") == 0) {
-            envPath = arg.substr(11);
+            options.envPath = arg.substr(11);
+        } else if (arg.find("--base-url=") == 0) {
+            options.baseUrl = arg.substr(11);
+        } else if (arg.find("--endpoints=") == 0) {
+            options.endpoints = splitList(arg.substr(12));
+        } else if (arg == "--typed") {
+            options.typed = true;
+        } else if (arg.find("--filter=") == 0) {
+            options.query.filters.push_back(WorkOrderIndex::parseCondition(arg.substr(9)));
+            options.typed = true;
+        } else if (arg.find("--aggregate=") == 0) {
+            options.query.aggregateBy = arg.substr(12);
+            WorkOrderAggregator::checkGroupBy(options.query.aggregateBy);
+            options.typed = true;
+        } else if (arg.find("--measures=") == 0) {
+            options.query.measures = splitList(arg.substr(11));
+            if (options.query.measures.empty()) {
+                throw std::runtime_error("--measures needs at least one money field");
+            }
+            for (const std::string& measure : options.query.measures) {
+                WorkOrderAggregator::checkMeasure(measure);
+            }
+        } else if (arg == "--stream") {
+            options.stream = true;
+        } else if (arg == "--stats") {
+            options.stats = true;
+        } else if (arg == "--timing") {
+            options.timing = true;
+        } else if (arg.find("--cache-path=") == 0) {
+            options.cachePath = arg.substr(13);
+        } else if (arg.find("--max-age=") == 0) {
+            options.maxAge = std::stoll(arg.substr(10));
+            if (options.maxAge < 0) {
+                throw std::runtime_error("--max-age must not be negative");
+            }
+        } else if (arg.find("--metrics-file=") == 0) {
+            options.metricsFile = arg.substr(15);
+        } else if (arg.find("--metrics-port=") == 0) {
+            options.metricsPort = std::stoi(arg.substr(15));
+            if (options.metricsPort < 1 || options.metricsPort > 65535) {
+                throw std::runtime_error("--metrics-port must be between 1 and 65535");
+            }
+        } else if (arg.find("--retries=") == 0) {
+            options.retry.maxRetries = std::stoi(arg.substr(10));
+        } else if (arg.find("--retry-delay-ms=") == 0) {
+            options.retry.baseDelay = std::chrono::milliseconds(std::stoll(arg.substr(17)));
+        } else if (arg.find("--retry-max-delay-ms=") == 0) {
+            options.retry.maxDelay = std::chrono::milliseconds(std::stoll(arg.substr(21)));
+        } else if (arg.find("--deadline=") == 0) {
+            options.retry.deadline = std::chrono::seconds(std::stoll(arg.substr(11)));
+        } else if (arg.find("--rate-limit=") == 0) {
+            options.rateLimit = std::stod(arg.substr(13));
+        } else if (arg.find("--rate-burst=") == 0) {
+            options.rateBurst = std::stod(arg.substr(13));
+        } else if (arg.find("--serve=") == 0) {
+            options.serve = arg.substr(8);
+            if (options.serve.empty()) {
+                throw std::runtime_error("--serve needs host:port or unix:path");
+            }
+        } else if (arg.find("--interval=") == 0) {
+            options.interval = std::stoll(arg.substr(11));
+            if (options.interval < 1) {
+                throw std::runtime_error("--interval must be at least 1");
+            }
         }
     }
 
-    return envPath;
+    if (options.endpoints.empty()) {
+        throw std::runtime_error("--endpoints needs at least one endpoint");
+    }
+
+    if (options.maxAge >= 0 && options.cachePath.empty()) {
+        throw std::runtime_error("--max-age needs a snapshot, turn the cache on with --cache-path");
+    }
+
+    if (options.typed && (options.endpoints.size() != 1 || options.endpoints[0] != "projectWorkOrders")) {
+        throw std::runtime_error("--typed, --filter and --aggregate only work on projectWorkOrders, "
+                                 "they can't be combined with --endpoints");
+    }
+
+    if (options.endpoints.size() > 1 && (options.stream || !options.cachePath.empty() || options.maxAge >= 0)) {
+        throw std::runtime_error("--stream, --cache-path and --max-age work on a single endpoint, "
+                                 "they can't be combined with several --endpoints");
+    }
+
+    const RetryPolicy& retry = options.retry;
+    if (retry.maxRetries < 0 || retry.baseDelay.count() < 0 || retry.maxDelay.count() < 0 || retry.deadline.count() <= 0) {
+        throw std::runtime_error("--retries and the retry delays must not be negative, --deadline must be positive");
+    }
+
+    if (!(options.rateLimit >= 0) || !(options.rateBurst >= 1)) {
+        throw std::runtime_error("--rate-limit must not be negative, --rate-burst must be at least 1");
+    }
+
+    if (!options.serve.empty() && options.interval <= 0) {
+        options.interval = 60;
+    }
+
+    return options;
+}
+
+/**
+ * fetchSingle - Fetches one endpoint through the snapshot cache.
+ *
+ *   1. Loads the snapshot of the endpoint, if there is one that was
+ *      fetched from the same base URL with the same API key
+ *   2. If it is younger than --max-age it is output and the API is not
+ *      called at all
+ *   3. Otherwise the request carries the snapshot's ETag / Last-Modified,
+ *      and the body is written to a new snapshot while it downloads
+ *   4. The response is output as it is, typed (--typed) or as it arrives
+ *      (--stream); a 304 outputs the snapshot instead
+ *   5. The snapshot is committed, or refreshed after a 304
+ *   6. Responses served from the snapshot and the parse and format times
+ *      are recorded in the metrics
+ *
+ * Returns false if a streamed response failed half way; other failures
+ * throw.
+ */
+bool fetchSingle(InnergyClient& client, const Options& options) {
+    const std::string& endpoint = options.endpoints[0];
+    bool cached = !options.cachePath.empty();
+
+    SnapshotInfo source;
+    source.endpoint = endpoint;
+    source.baseUrl = client.currentBaseUrl();
+    source.keyHash = hashApiKey(client.currentApiKey());
+
+    std::unique_ptr<MappedSnapshot> snapshot;
+    if (cached) {
+        snapshot = MappedSnapshot::load(options.cachePath, source);
+    }
+
+    Diagnostics diagnostics;
+    diagnostics.stats = options.stats;
+    diagnostics.timing = options.timing;
+
+    if (snapshot && options.maxAge >= 0 && snapshot->freshFor(source, options.maxAge)) {
+        outputSnapshot(*snapshot, options.typed, options.query, diagnostics);
+        recordSnapshotServed(endpoint, "fresh");
+        recordOutput(endpoint, diagnostics);
+        return true;
+    }
+
+    Validators since;
+    if (snapshot) {
+        since.etag = snapshot->info().etag;
+        since.lastModified = snapshot->info().lastModified;
+    }
+
+    std::time_t fetchedAt = std::time(nullptr);
+    std::unique_ptr<SnapshotWriter> writer;
+    if (cached) {
+        writer = std::make_unique<SnapshotWriter>(options.cachePath);
+    }
+
+    FetchResult result;
+    WorkOrderBatch workOrders;
+
+    if (options.typed) {
+        WorkOrderDecoder decoder(workOrders);
+        JsonStreamParser parser(decoder);
+        result = client.fetchStreaming(endpoint, [&](const char* data, size_t size) {
+            Clock::time_point start = Clock::now();
+            parser.feed(data, size);
+            diagnostics.parseMs += millisecondsSince(start);
+            if (writer) writer->append(data, size);
+        }, since);
+        if (result.ok()) {
+            Clock::time_point start = Clock::now();
+            parser.finish();
+            diagnostics.parseMs += millisecondsSince(start);
+        }
+    } else if (options.stream) {
+        result = outputStream(client, endpoint, writer.get(), since, diagnostics);
+    } else {
+        result = client.fetchIfChanged(endpoint, since);
+        if (writer && result.ok()) writer->append(result.body);
+    }
+
+    if (result.notModified() && !snapshot) {
+        throw std::runtime_error("API returned 304 but there is no snapshot");
+    }
+
+    if (writer) {
+        saveSnapshot(options.cachePath, *writer, snapshot.get(), source, result, fetchedAt);
+    }
+
+    if (!result.ok() && !result.notModified()) {
+        return false;
+    }
+
+    diagnostics.fetch = &result;
+    if (result.notModified()) {
+        outputSnapshot(*snapshot, options.typed, options.query, diagnostics);
+        recordSnapshotServed(endpoint, "not_modified");
+    } else if (options.typed) {
+        outputTyped(workOrders.items, options.query, diagnostics);
+    } else if (!options.stream) {
+        outputSuccess(result.body, &diagnostics);
+    }
+    recordOutput(endpoint, diagnostics);
+    return true;
+}
+
+/**
+ * fetchAll - One run: fetches the endpoints and outputs them. Returns
+ * whether the run succeeded; errors are output and count as failure.
+ *
+ *   1. A single endpoint goes through fetchSingle
+ *   2. Several endpoints are fetched concurrently by a MultiFetcher and
+ *      each result is stored by its completion callback
+ */
+bool fetchAll(InnergyClient& client, const Options& options) {
+    try {
+        if (options.endpoints.size() == 1) {
+            return fetchSingle(client, options);
+        }
+
+        std::vector<FetchResult> results(options.endpoints.size());
+        MultiFetcher fetcher(client);
+        for (size_t i = 0; i < options.endpoints.size(); i++) {
+            fetcher.add(options.endpoints[i], [&results, i](FetchResult& result) {
+                results[i] = std::move(result);
+            });
+        }
+        fetcher.run();
+        Diagnostics diagnostics;
+        diagnostics.stats = options.stats;
+        diagnostics.timing = options.timing;
+        return outputResults(results, diagnostics);
+    } catch (const std::exception& e) {
+        outputError(e.what());
+        return false;
+    }
+}
+
+/**
+ * writeMetrics - Writes the metrics to --metrics-file, if one was given.
+ * A failure is reported on stderr; it doesn't change the run's outcome.
+ */
+void writeMetrics(const Options& options) {
+    if (options.metricsFile.empty()) return;
+    try {
+        metrics().writeFile(options.metricsFile);
+    } catch (const std::exception& e) {
+        std::cerr << "warning: " << e.what() << std::endl;
+    }
+}
+
+/**
+ * serveMetrics - Answers GET /metrics with the metrics of this process.
+ */
+HttpResponse serveMetrics(const HttpRequest& request) {
+    HttpResponse response;
+    if (request.path != "/metrics") {
+        response.status = 404;
+        response.body = "Not found\n";
+    } else if (request.method != "GET" && request.method != "HEAD") {
+        response.status = 405;
+        response.body = "Method not allowed\n";
+    } else {
+        response.contentType = "text/plain; version=0.0.4; charset=utf-8";
+        response.body = metrics().render();
+    }
+    return response;
+}
+
+/**
+ * listenAddress - Splits a --serve address like "127.0.0.1:8080" or
+ * ":8080" (127.0.0.1) into host and port.
+ */
+void listenAddress(const std::string& address, std::string& host, int& port) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        throw std::runtime_error("--serve needs host:port or unix:path, got " + address);
+    }
+    host = colon == 0 ? "127.0.0.1" : address.substr(0, colon);
+    port = std::stoi(address.substr(colon + 1));
+    if (port < 1 || port > 65535) {
+        throw std::runtime_error("--serve port must be between 1 and 65535");
+    }
+}
+
+/**
+ * runService - The --serve mode: refreshes the endpoints in the background
+ * and serves them until SIGINT or SIGTERM.
+ *
+ *   1. Blocks SIGINT and SIGTERM before any thread starts, so every
+ *      thread inherits the mask and this one can wait for them
+ *   2. Starts the WorkOrderService, which fetches right away and then
+ *      every --interval seconds
+ *   3. Serves GET /<endpoint>, /healthz and /metrics on the --serve
+ *      address, a TCP port or a Unix socket
+ *   4. On a signal stops the server first, then cancels a refresh that
+ *      may be running (or waiting for a retry) and stops the refresh
+ *      thread
+ */
+void runService(InnergyClient& client, const Options& options) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    WorkOrderService service(client, options.endpoints, std::chrono::seconds(options.interval));
+    service.setObserver(recordRefresh);
+
+    HttpHandler handler = [&service](const HttpRequest& request) {
+        return request.path == "/metrics" ? serveMetrics(request) : service.handle(request);
+    };
+
+    std::unique_ptr<HttpServer> server;
+    if (options.serve.compare(0, 5, "unix:") == 0) {
+        server = std::make_unique<HttpServer>(options.serve.substr(5), handler);
+    } else {
+        std::string host;
+        int port = 0;
+        listenAddress(options.serve, host, port);
+        server = std::make_unique<HttpServer>(host, port, handler);
+    }
+    server->start();
+    service.start();
+    std::cerr << "serving " << options.serve << ", refreshing every " << options.interval << "s" << std::endl;
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+    server->stop();
+    client.cancel();
+    service.stop();
 }
 
 /**
  * main - Entry point of the program.
  *
  *   1. Initializes cURL globally (required once before any cURL calls)
- *   2. Parses command line arguments to get .env file path
+ *   2. Parses command line arguments into Options
  *   3. Loads environment variables from the .env file
  *   4. Checks that API_KEY exists and is not empty
- *   5. Calls fetchWorkOrders to get data from the API
- *   6. Outputs the successful response as formatted JSON
- *   7. Catches any exceptions and outputs error JSON instead
- *   8. Cleans up cURL globally before exiting
- *   9. Returns 0 for success
+ *   5. Creates an InnergyClient whose observer records every request in
+ *      the metrics, paced by a RateLimiter with --rate-limit, and starts
+ *      the metrics server for --metrics-port; with --serve it hands over
+ *      to runService instead of fetching itself
+ *   6. Fetches and outputs the endpoints with fetchAll; with --typed the
+ *      response is decoded into WorkOrder structs while it downloads,
+ *      with --stream it is printed as it downloads
+ *   7. Records the outcome of the run and writes --metrics-file; with
+ *      --interval it then sleeps and starts over, printing one JSON
+ *      object per run
+ *   8. Catches any exceptions and outputs error JSON instead; they count
+ *      as a failed run in the metrics too
+ *   9. Cleans up cURL globally before exiting
+ *   10. Returns 0 for success
  */
 int main(int argc, char* argv[]) {
     curl_global_init(CURL_GLOBAL_DEFAULT);
 
+    Options options;
     try {
-        std::string envPath = parseEnvPath(argc, argv);
-        auto env = loadEnvFile(envPath);
+        options = parseOptions(argc, argv);
+        auto env = loadEnvFile(options.envPath);
 
         if (env.find("API_KEY") == env.end() || env["API_KEY"].empty()) {
             throw std::runtime_error("API_KEY not found in .env file");
         }
 
-        std::string response = fetchWorkOrders(env["API_KEY"]);
-        outputSuccess(response);
+        InnergyClient client(env["API_KEY"]);
+        client.setObserver(transferRecorder(options.endpoints));
+        client.setRetryPolicy(options.retry);
+        if (!options.baseUrl.empty()) {
+            client.setBaseUrl(options.baseUrl);
+        }
+        if (options.rateLimit > 0) {
+            auto limiter = std::make_shared<RateLimiter>(options.rateLimit, options.rateBurst);
+            client.setRateLimiter(limiter);
+            std::string host = RateLimiter::hostOf(client.currentBaseUrl());
+            watchRateLimiter(limiter, limiter->bucket(host, client.currentApiKey()), host);
+        }
+
+        std::unique_ptr<HttpServer> metricsServer;
+        if (options.metricsPort > 0) {
+            metricsServer = std::make_unique<HttpServer>("127.0.0.1", options.metricsPort, serveMetrics);
+            metricsServer->start();
+        }
+
+        if (!options.serve.empty()) {
+            runService(client, options);
+        } else {
+            while (true) {
+                recordRun(fetchAll(client, options));
+                writeMetrics(options);
+
+                if (options.interval <= 0) break;
+                std::this_thread::sleep_for(std::chrono::seconds(options.interval));
+            }
+        }
 
     } catch (const std::exception& e) {
         outputError(e.what());
+        recordRun(false);
+        writeMetrics(options);
     }
 
     curl_global_cleanup();